@@ -877,6 +877,38 @@ PLUTOBOOK_API bool plutobook_load_image(plutobook_t* book, const char* data, uns
 PLUTOBOOK_API bool plutobook_load_xml(plutobook_t* book, const char* data, int length,
     const char* user_style, const char* user_script, const char* base_url);
 
+/**
+ * @brief Begins loading the document incrementally from XML data supplied in chunks.
+ *
+ * The previous content is cleared. Feed the data with `plutobook_load_xml_write` and
+ * complete the document with `plutobook_load_xml_end`.
+ *
+ * @param book A pointer to a `plutobook_t` object.
+ * @param user_style An optional user-defined style to apply.
+ * @param user_script An optional user-defined script to run after the document has loaded.
+ * @param base_url The base URL for resolving relative URLs.
+ * @return `true` on success, or `false` on failure.
+ */
+PLUTOBOOK_API bool plutobook_load_xml_begin(plutobook_t* book, const char* user_style, const char* user_script, const char* base_url);
+
+/**
+ * @brief Parses the next chunk of XML data.
+ *
+ * @param book A pointer to a `plutobook_t` object.
+ * @param data The next chunk of XML data. Chunks may be split at any byte.
+ * @param length The length of the chunk in bytes, or `-1` if null-terminated.
+ * @return `true` on success, or `false` on a parse error or if no incremental load is in progress.
+ */
+PLUTOBOOK_API bool plutobook_load_xml_write(plutobook_t* book, const char* data, int length);
+
+/**
+ * @brief Finishes the incremental load started with `plutobook_load_xml_begin`.
+ *
+ * @param book A pointer to a `plutobook_t` object.
+ * @return `true` on success, or `false` on failure.
+ */
+PLUTOBOOK_API bool plutobook_load_xml_end(plutobook_t* book);
+
 /**
  * @brief Loads the document from the specified HTML data.
  *
@@ -891,6 +923,38 @@ PLUTOBOOK_API bool plutobook_load_xml(plutobook_t* book, const char* data, int l
 PLUTOBOOK_API bool plutobook_load_html(plutobook_t* book, const char* data, int length,
     const char* user_style, const char* user_script, const char* base_url);
 
+/**
+ * @brief Begins loading the document incrementally from HTML data supplied in chunks.
+ *
+ * The previous content is cleared. Feed the data with `plutobook_load_html_write` and
+ * complete the document with `plutobook_load_html_end`.
+ *
+ * @param book A pointer to a `plutobook_t` object.
+ * @param user_style An optional user-defined style to apply.
+ * @param user_script An optional user-defined script to run after the document has loaded.
+ * @param base_url The base URL for resolving relative URLs.
+ * @return `true` on success, or `false` on failure.
+ */
+PLUTOBOOK_API bool plutobook_load_html_begin(plutobook_t* book, const char* user_style, const char* user_script, const char* base_url);
+
+/**
+ * @brief Parses the next chunk of HTML data.
+ *
+ * @param book A pointer to a `plutobook_t` object.
+ * @param data The next chunk of HTML data, encoded in UTF-8. Chunks may be split at any byte.
+ * @param length The length of the chunk in bytes, or `-1` if null-terminated.
+ * @return `true` on success, or `false` if no incremental load is in progress.
+ */
+PLUTOBOOK_API bool plutobook_load_html_write(plutobook_t* book, const char* data, int length);
+
+/**
+ * @brief Finishes the incremental load started with `plutobook_load_html_begin`.
+ *
+ * @param book A pointer to a `plutobook_t` object.
+ * @return `true` on success, or `false` on failure.
+ */
+PLUTOBOOK_API bool plutobook_load_html_end(plutobook_t* book);
+
 /**
  * @brief Renders the specified page to the given canvas.
  *
@@ -1047,6 +1111,25 @@ PLUTOBOOK_API plutobook_resource_fetch_callback_t plutobook_get_custom_resource_
  */
 PLUTOBOOK_API void* plutobook_get_custom_resource_fetcher_closure(const plutobook_t* book);
 
+/**
+ * @brief Sets the number of threads used to match style rules while building the document.
+ *
+ * The default is `1`, which matches every element on the calling thread. Pass `0`
+ * to use one thread per hardware core. The computed styles do not depend on this setting.
+ *
+ * @param book A pointer to a `plutobook_t` object.
+ * @param count The number of threads, or `0` to use one thread per hardware core.
+ */
+PLUTOBOOK_API void plutobook_set_style_thread_count(plutobook_t* book, unsigned int count);
+
+/**
+ * @brief Gets the number of threads used to match style rules.
+ *
+ * @param book A pointer to a `plutobook_t` object.
+ * @return The number of threads, or `0` if one thread per hardware core is used.
+ */
+PLUTOBOOK_API unsigned int plutobook_get_style_thread_count(const plutobook_t* book);
+
 /**
  * @brief Sets the error message for the current thread.
  *
@@ -1092,11 +1175,94 @@ PLUTOBOOK_API void plutobook_clear_error_message(void);
  * @param path A null-terminated string specifying the directory containing Fontconfig
  * configuration files.
  *
- * @note This function must be called before creating any `plutobook_t` instance
- * to ensure that Fontconfig uses the specified configuration path.
+ * @note Because this modifies the process environment, no other thread may be using
+ * plutobook while this function runs. If fonts were already looked up, the Fontconfig
+ * configuration and the installed font family index are rebuilt on the next lookup.
+ * Documents that were already loaded keep the fonts they use.
  */
 PLUTOBOOK_API void plutobook_set_fontconfig_path(const char* path);
 
+/**
+ * @brief Sets the file used to persist font lookup results across processes.
+ *
+ * When set, later processes answer font lookups from this file without initializing
+ * Fontconfig, as long as the Fontconfig font directories and configuration files have
+ * not been modified since the file was written. The file is rewritten when the process exits.
+ *
+ * @param path A null-terminated string specifying the cache file path, or an empty string
+ * to disable the cache.
+ */
+PLUTOBOOK_API void plutobook_set_font_metadata_cache_path(const char* path);
+
+/**
+ * @brief Enables or disables the process-wide cache of parsed style sheets.
+ *
+ * When enabled, linked, imported and preloaded style sheets with the same URL, origin
+ * and content are parsed once and shared by every `plutobook_t` instance in the process.
+ * Inline and user style sheets are never cached. At most 256 style sheets are kept,
+ * and the least recently used ones are evicted first. The cache is disabled by default.
+ *
+ * @param enabled `true` to enable the cache, `false` to disable it.
+ */
+PLUTOBOOK_API void plutobook_set_stylesheet_cache_enabled(bool enabled);
+
+/**
+ * @brief Parses an author style sheet into the process-wide style sheet cache.
+ *
+ * @param data The style sheet content, encoded in UTF-8.
+ * @param length The length of the style sheet content in bytes, or `-1` if null-terminated.
+ * @param url The URL the style sheet is loaded from.
+ * @return `true` on success, or `false` if the style sheet cache is disabled.
+ */
+PLUTOBOOK_API bool plutobook_preload_stylesheet(const char* data, int length, const char* url);
+
+/**
+ * @brief Removes the style sheets loaded from the specified URL from the process-wide style sheet cache.
+ *
+ * Documents that already use the removed style sheets keep them alive until they are destroyed.
+ *
+ * @param url The URL the style sheets were loaded from.
+ */
+PLUTOBOOK_API void plutobook_evict_stylesheet(const char* url);
+
+/**
+ * @brief Removes all style sheets from the process-wide style sheet cache.
+ */
+PLUTOBOOK_API void plutobook_clear_stylesheet_cache(void);
+
+/**
+ * @brief Counters describing the process-wide text shaping cache.
+ */
+typedef struct _plutobook_shape_cache_stats {
+    unsigned long long hits;   /**< Number of words found in the cache */
+    unsigned long long misses; /**< Number of words that had to be shaped */
+    unsigned int entries;      /**< Number of words currently cached */
+    unsigned int capacity;     /**< Maximum number of words kept in the cache */
+} plutobook_shape_cache_stats_t;
+
+/**
+ * @brief Sets the maximum number of shaped words kept in the process-wide text shaping cache.
+ *
+ * When the capacity is non-zero, text is shaped word by word and each shaped word is
+ * shared by every `plutobook_t` instance in the process, with the least recently used words
+ * evicted first. The cache is disabled by default (capacity `0`).
+ *
+ * @param capacity The maximum number of cached words, or `0` to disable the cache.
+ */
+PLUTOBOOK_API void plutobook_set_shape_cache_capacity(unsigned int capacity);
+
+/**
+ * @brief Returns the hit/miss counters and size of the process-wide text shaping cache.
+ *
+ * @return The current shaping cache statistics.
+ */
+PLUTOBOOK_API plutobook_shape_cache_stats_t plutobook_get_shape_cache_stats(void);
+
+/**
+ * @brief Removes all words from the process-wide text shaping cache and resets its counters.
+ */
+PLUTOBOOK_API void plutobook_clear_shape_cache(void);
+
 #ifdef __cplusplus
 }
 #endif
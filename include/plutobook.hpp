@@ -1079,6 +1079,8 @@ public:
 
 class Heap;
 class Document;
+class HTMLParser;
+class XMLParser;
 
 /**
  * @brief Defines the different media types used for CSS @media queries.
@@ -1297,6 +1299,32 @@ public:
     bool loadXml(std::string_view content, std::string_view userStyle = {},
         std::string_view userScript = {}, std::string_view baseUrl = {});
 
+    /**
+     * @brief Begins loading the document incrementally from XML data supplied in chunks.
+     *
+     * The previous content is cleared. Feed the data with `loadXmlWrite` and complete
+     * the document with `loadXmlEnd`. Until then, the book behaves as if it had no document.
+     * @param userStyle An optional user-defined style to apply.
+     * @param userScript An optional user-defined script to run after the document has loaded.
+     * @param baseUrl The base URL for resolving relative URLs.
+     * @return `true` on success, or `false` on failure.
+     */
+    bool loadXmlBegin(std::string_view userStyle = {},
+        std::string_view userScript = {}, std::string_view baseUrl = {});
+
+    /**
+     * @brief Parses the next chunk of XML data.
+     * @param content The next chunk of XML data. Chunks may be split at any byte.
+     * @return `true` on success, or `false` on a parse error or if no incremental load is in progress.
+     */
+    bool loadXmlWrite(std::string_view content);
+
+    /**
+     * @brief Finishes the incremental load started with `loadXmlBegin`.
+     * @return `true` on success, or `false` on failure.
+     */
+    bool loadXmlEnd();
+
     /**
      * @brief Loads the document from the specified HTML data.
      * @param content The HTML data to load the document from, encoded in UTF-8.
@@ -1308,6 +1336,34 @@ public:
     bool loadHtml(std::string_view content, std::string_view userStyle = {},
         std::string_view userScript = {}, std::string_view baseUrl = {});
 
+    /**
+     * @brief Begins loading the document incrementally from HTML data supplied in chunks.
+     *
+     * The previous content is cleared. Feed the data with `loadHtmlWrite` and complete
+     * the document with `loadHtmlEnd`. Until then, the book behaves as if it had no document.
+     * @param userStyle An optional user-defined style to apply.
+     * @param userScript An optional user-defined script to run after the document has loaded.
+     * @param baseUrl The base URL for resolving relative URLs.
+     * @return `true` on success, or `false` on failure.
+     */
+    bool loadHtmlBegin(std::string_view userStyle = {},
+        std::string_view userScript = {}, std::string_view baseUrl = {});
+
+    /**
+     * @brief Parses the next chunk of HTML data, encoded in UTF-8.
+     *
+     * Chunks may be split at any byte; parsed input is released as soon as it is consumed.
+     * @param content The next chunk of HTML data.
+     * @return `true` on success, or `false` if no incremental load is in progress.
+     */
+    bool loadHtmlWrite(std::string_view content);
+
+    /**
+     * @brief Finishes the incremental load started with `loadHtmlBegin`.
+     * @return `true` on success, or `false` on failure.
+     */
+    bool loadHtmlEnd();
+
     /**
      * @brief Clears the content of the document.
      */
@@ -1458,6 +1514,23 @@ public:
      */
     ResourceFetcher* customResourceFetcher() const { return m_customResourceFetcher; }
 
+    /**
+     * @brief Sets the number of threads used to match style rules while building the document.
+     *
+     * The default is `1`, which matches every element on the calling thread. Pass `0`
+     * to use one thread per hardware core. The computed styles do not depend on this setting.
+     *
+     * @param count The number of threads, or `0` to use one thread per hardware core.
+     */
+    void setStyleThreadCount(uint32_t count) { m_styleThreadCount = count; }
+
+    /**
+     * @brief Retrieves the number of threads used to match style rules.
+     *
+     * @return The number of threads, or `0` if one thread per hardware core is used.
+     */
+    uint32_t styleThreadCount() const { return m_styleThreadCount; }
+
     /**
      * @internal
      */
@@ -1496,11 +1569,110 @@ private:
     PDFString m_modificationDate;
 
     ResourceFetcher* m_customResourceFetcher{nullptr};
+    uint32_t m_styleThreadCount{1};
+
+    std::string m_pendingUserStyle;
+    std::string m_pendingUserScript;
 
     std::unique_ptr<Heap> m_heap;
     std::unique_ptr<Document> m_document;
+    std::unique_ptr<HTMLParser> m_htmlParser;
+    std::unique_ptr<XMLParser> m_xmlParser;
 };
 
+/**
+ * @brief Enables or disables the process-wide cache of parsed style sheets.
+ *
+ * When enabled, linked, imported and preloaded style sheets with the same URL, origin
+ * and content are parsed once and shared by every `Book` instance in the process.
+ * Inline and user style sheets are never cached. At most 256 style sheets are kept,
+ * and the least recently used ones are evicted first. The cache is disabled by default.
+ *
+ * @param enabled `true` to enable the cache, `false` to disable it.
+ */
+PLUTOBOOK_API void setStyleSheetCacheEnabled(bool enabled);
+
+/**
+ * @brief Parses an author style sheet into the process-wide style sheet cache.
+ * @param content The style sheet content, encoded in UTF-8.
+ * @param url The URL the style sheet is loaded from.
+ * @return `true` on success, or `false` if the style sheet cache is disabled.
+ */
+PLUTOBOOK_API bool preloadStyleSheet(std::string_view content, std::string_view url);
+
+/**
+ * @brief Removes the style sheets loaded from the specified URL from the process-wide style sheet cache.
+ *
+ * Documents that already use the removed style sheets keep them alive until they are destroyed.
+ *
+ * @param url The URL the style sheets were loaded from.
+ */
+PLUTOBOOK_API void evictStyleSheet(std::string_view url);
+
+/**
+ * @brief Removes all style sheets from the process-wide style sheet cache.
+ */
+PLUTOBOOK_API void clearStyleSheetCache();
+
+/**
+ * @brief Counters describing the process-wide text shaping cache.
+ */
+struct ShapeCacheStatistics {
+    uint64_t hits;     ///< Number of words found in the cache.
+    uint64_t misses;   ///< Number of words that had to be shaped.
+    size_t entries;    ///< Number of words currently cached.
+    size_t capacity;   ///< Maximum number of words kept in the cache.
+};
+
+/**
+ * @brief Sets the maximum number of shaped words kept in the process-wide text shaping cache.
+ *
+ * When the capacity is non-zero, text is shaped word by word and each shaped word is
+ * shared by every `Book` instance in the process, with the least recently used words
+ * evicted first. The cache is disabled by default (capacity `0`).
+ *
+ * @param capacity The maximum number of cached words, or `0` to disable the cache.
+ */
+PLUTOBOOK_API void setShapeCacheCapacity(size_t capacity);
+
+/**
+ * @brief Returns the hit/miss counters and size of the process-wide text shaping cache.
+ * @return The current shaping cache statistics.
+ */
+PLUTOBOOK_API ShapeCacheStatistics shapeCacheStatistics();
+
+/**
+ * @brief Removes all words from the process-wide text shaping cache and resets its counters.
+ */
+PLUTOBOOK_API void clearShapeCache();
+
+/**
+ * @brief Sets the directory Fontconfig loads its configuration files from.
+ *
+ * This sets the `FONTCONFIG_PATH` environment variable for the current process. If fonts
+ * were already looked up, the Fontconfig configuration and the installed font family index
+ * are rebuilt on the next lookup. Documents that were already loaded keep the fonts they use.
+ *
+ * @note Because this modifies the process environment, no other thread may be using
+ * plutobook while this function runs.
+ *
+ * @param path The directory containing Fontconfig configuration files.
+ */
+PLUTOBOOK_API void setFontconfigPath(const std::string& path);
+
+/**
+ * @brief Sets the file used to persist font lookup results across processes.
+ *
+ * When set, the font chosen for each family and fallback lookup is recorded together
+ * with the modification times of the Fontconfig font directories and configuration files,
+ * and the file is rewritten when the process exits. While the file is fresh, later processes
+ * answer those lookups from it without initializing Fontconfig; Fontconfig is only loaded for
+ * lookups the file does not cover. The cache is disabled by default (empty path).
+ *
+ * @param path The cache file path, or an empty string to disable the cache.
+ */
+PLUTOBOOK_API void setFontMetadataCachePath(const std::string& path);
+
 } // namespace plutobook
 
 #endif // PLUTOBOOK_HPP
@@ -26,8 +26,15 @@ CSSRuleList CSSParser::parseSheet(std::string_view content)
 {
     CSSRuleList rules(m_heap);
     CSSTokenizer tokenizer(content);
-    CSSTokenStream input(tokenizer.tokenize());
-    consumeRuleList(input, rules);
+    m_content = content;
+    while(true) {
+        auto input = tokenizer.tokenizeRule();
+        if(input.empty())
+            break;
+        consumeRuleList(input, rules);
+    }
+
+    m_content = std::string_view();
     return rules;
 }
 
@@ -274,9 +281,21 @@ RefPtr<CSSStyleRule> CSSParser::consumeStyleRule(CSSTokenStream& input)
     if(input.empty())
         return nullptr;
     CSSSelectorList selectors(m_heap);
+    auto blockOpen = input.begin();
     auto block = input.consumeBlock();
     if(!consumeSelectorList(prelude, selectors, false))
         return nullptr;
+    if(!m_content.empty()) {
+        auto begin = blockOpen->offset();
+        auto end = m_content.size();
+        if(block.end() != input.begin())
+            end = block.end()->offset();
+        if(m_ruleContext == nullptr)
+            m_ruleContext = CSSRuleParserContext::create(m_heap, m_context);
+        auto declarations = m_heap->createString(m_content.substr(begin, end - begin));
+        return CSSStyleRule::create(m_heap, std::move(selectors), m_ruleContext, declarations);
+    }
+
     CSSPropertyList properties(m_heap);
     consumeDeclarationList(block, properties, CSSRuleType::Style);
     return CSSStyleRule::create(m_heap, std::move(selectors), std::move(properties));
@@ -200,6 +200,8 @@ private:
     const CSSParserContext& m_context;
     std::map<GlobalString, GlobalString> m_namespaces;
     GlobalString m_defaultNamespace = starGlo;
+    RefPtr<CSSRuleParserContext> m_ruleContext;
+    std::string_view m_content;
 };
 
 } // namespace plutobook
@@ -1092,18 +1092,18 @@ CSSVariableData::CSSVariableData(Heap* heap, const CSSTokenStream& value)
     }
 }
 
-bool CSSVariableData::resolve(const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references) const
+bool CSSVariableData::resolve(const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references, CSSVariableDependencyList& dependencies) const
 {
     CSSTokenStream input(m_tokens.data(), m_tokens.size());
-    return resolve(input, style, tokens, references);
+    return resolve(input, style, tokens, references, dependencies);
 }
 
-bool CSSVariableData::resolve(CSSTokenStream input, const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references) const
+bool CSSVariableData::resolve(CSSTokenStream input, const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references, CSSVariableDependencyList& dependencies) const
 {
     while(!input.empty()) {
         if(input->type() == CSSToken::Type::Function && equalsIgnoringCase("var", input->data())) {
             auto block = input.consumeBlock();
-            if(!resolveVar(block, style, tokens, references))
+            if(!resolveVar(block, style, tokens, references, dependencies))
                 return false;
             continue;
         }
@@ -1115,25 +1115,27 @@ bool CSSVariableData::resolve(CSSTokenStream input, const BoxStyle* style, CSSTo
     return true;
 }
 
-bool CSSVariableData::resolveVar(CSSTokenStream input, const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references) const
+bool CSSVariableData::resolveVar(CSSTokenStream input, const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references, CSSVariableDependencyList& dependencies) const
 {
     input.consumeWhitespace();
     if(input->type() != CSSToken::Type::Ident)
         return false;
-    auto data = style->getCustom(input->data());
+    auto name = input->data();
+    auto data = style->getCustom(name);
+    dependencies.emplace_back(name, data);
     input.consumeIncludingWhitespace();
     if(!input.empty() && input->type() != CSSToken::Type::Comma)
         return false;
     if(data == nullptr) {
         if(!input.consumeCommaIncludingWhitespace())
             return false;
-        return resolve(input, style, tokens, references);
+        return resolve(input, style, tokens, references, dependencies);
     }
 
     if(references.contains(data))
         return false;
     references.insert(data);
-    return data->resolve(style, tokens, references);
+    return data->resolve(style, tokens, references, dependencies);
 }
 
 RefPtr<CSSCustomPropertyValue> CSSCustomPropertyValue::create(Heap* heap, const HeapString& name, RefPtr<CSSVariableData> value)
@@ -1154,20 +1156,53 @@ CSSParserContext::CSSParserContext(const Node* node, CSSStyleOrigin origin, Url
 {
 }
 
+CSSParserContext::CSSParserContext(bool inHTMLDocument, bool inSVGElement, CSSStyleOrigin origin, Url baseUrl)
+    : m_inHTMLDocument(inHTMLDocument)
+    , m_inSVGElement(inSVGElement)
+    , m_origin(origin)
+    , m_baseUrl(std::move(baseUrl))
+{
+}
+
 RefPtr<CSSVariableReferenceValue> CSSVariableReferenceValue::create(Heap* heap, const CSSParserContext& context, CSSPropertyID id, bool important, RefPtr<CSSVariableData> value)
 {
     return adoptPtr(new (heap) CSSVariableReferenceValue(context, id, important, std::move(value)));
 }
 
+static bool matchVariableDependencies(const CSSVariableDependencyList& dependencies, const BoxStyle* style)
+{
+    for(const auto& [name, data] : dependencies) {
+        if(style->getCustom(name) != data) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 CSSPropertyList CSSVariableReferenceValue::resolve(const BoxStyle* style) const
 {
+    auto& variableCache = style->document()->variableCache();
+    auto range = variableCache.equal_range(this);
+    size_t resolutionCount = 0;
+    for(auto it = range.first; it != range.second; ++it) {
+        if(matchVariableDependencies(it->second.dependencies, style))
+            return it->second.properties;
+        ++resolutionCount;
+    }
+
     CSSTokenList tokens;
     std::set<CSSVariableData*> references;
-    if(!m_value->resolve(style, tokens, references))
+    CSSVariableDependencyList dependencies;
+    if(!m_value->resolve(style, tokens, references, dependencies))
         return CSSPropertyList();
     CSSTokenStream input(tokens.data(), tokens.size());
     CSSParser parser(m_context, style->heap());
-    return parser.parsePropertyValue(input, m_id, m_important);
+    auto properties = parser.parsePropertyValue(input, m_id, m_important);
+    constexpr size_t kMaxResolutionCount = 16;
+    if(resolutionCount < kMaxResolutionCount)
+        variableCache.emplace(this, DocumentVariableResolution{std::move(dependencies), properties});
+    return properties;
 }
 
 CSSVariableReferenceValue::CSSVariableReferenceValue(const CSSParserContext& context, CSSPropertyID id, bool important, RefPtr<CSSVariableData> value)
@@ -1182,13 +1217,7 @@ RefPtr<CSSImageValue> CSSImageValue::create(Heap* heap, Url value)
 
 const RefPtr<Image>& CSSImageValue::fetch(Document* document) const
 {
-    if(m_image == nullptr) {
-        if(auto resource = document->fetchImageResource(m_value)) {
-            m_image = resource->image();
-        }
-    }
-
-    return m_image;
+    return document->fetchImage(*this);
 }
 
 CSSImageValue::CSSImageValue(Url value)
@@ -717,17 +717,20 @@ struct is_a<CSSCustomIdentValue> {
 };
 
 class BoxStyle;
+class CSSVariableData;
+
+using CSSVariableDependencyList = std::vector<std::pair<std::string_view, const CSSVariableData*>>;
 
 class CSSVariableData : public HeapMember, public RefCounted<CSSVariableData> {
 public:
     static RefPtr<CSSVariableData> create(Heap* heap, const CSSTokenStream& value);
 
-    bool resolve(const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references) const;
+    bool resolve(const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references, CSSVariableDependencyList& dependencies) const;
 
 private:
     CSSVariableData(Heap* heap, const CSSTokenStream& value);
-    bool resolve(CSSTokenStream input, const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references) const;
-    bool resolveVar(CSSTokenStream input, const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references) const;
+    bool resolve(CSSTokenStream input, const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references, CSSVariableDependencyList& dependencies) const;
+    bool resolveVar(CSSTokenStream input, const BoxStyle* style, CSSTokenList& tokens, std::set<CSSVariableData*>& references, CSSVariableDependencyList& dependencies) const;
     std::pmr::vector<CSSToken> m_tokens;
 };
 
@@ -755,6 +758,7 @@ class Node;
 class CSSParserContext {
 public:
     CSSParserContext(const Node* node, CSSStyleOrigin origin, Url baseUrl);
+    CSSParserContext(bool inHTMLDocument, bool inSVGElement, CSSStyleOrigin origin, Url baseUrl);
 
     bool inHTMLDocument() const { return m_inHTMLDocument; }
     bool inSVGElement() const { return m_inSVGElement; }
@@ -1171,7 +1175,6 @@ public:
 private:
     CSSImageValue(Url value);
     Url m_value;
-    mutable RefPtr<Image> m_image;
 };
 
 template<>
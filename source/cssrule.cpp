@@ -15,8 +15,24 @@
 
 #include <unicode/uiter.h>
 
+#include <mutex>
+
 namespace plutobook {
 
+const CSSPropertyList& CSSStyleRule::properties() const
+{
+    if(m_hasProperties.load(std::memory_order_acquire))
+        return m_properties;
+    std::lock_guard guard(m_context->heap()->mutex());
+    if(!m_hasProperties.load(std::memory_order_relaxed)) {
+        CSSParser parser(m_context->context(), m_context->heap());
+        m_properties = parser.parseStyle(m_declarations);
+        m_hasProperties.store(true, std::memory_order_release);
+    }
+
+    return m_properties;
+}
+
 bool CSSSimpleSelector::matchNth(int count) const
 {
     const auto [a, b] = matchPattern();
@@ -137,6 +153,10 @@ void SelectorFilter::push(const Element* element)
             hashes.push_back(hashString(className));
         }
 
+        for(const auto& attribute : element->attributes()) {
+            hashes.push_back(hashString(attribute.name().foldCase()) * attributeSalt);
+        }
+
         element = element->parentElement();
     } while(element && m_stack.empty());
     if(m_stack.empty())
@@ -153,39 +173,116 @@ void SelectorFilter::pop()
     m_stack.pop_back();
 }
 
-CSSRuleData::CSSRuleData(CSSStyleRule& rule, const CSSSelector& selector, uint32_t specificity, uint32_t position)
-    : m_rule(rule), m_selector(selector), m_specificity(specificity), m_position(position)
+CSSRuleData::CSSRuleData(CSSStyleRule& rule, const CSSSelector& selector, PseudoType pseudoType, uint32_t specificity, uint32_t position)
+    : m_rule(rule), m_selector(selector), m_specificity(specificity), m_position(position), m_pseudoType(pseudoType)
+    , m_preventsStyleSharing(isStructuralSelector(selector))
+{
+    unsigned index = 0;
+    collectSelectorHashes(selector, false, index);
+    if(index < maxHashCount) {
+        m_hashes[index] = 0;
+    }
+}
+
+void CSSRuleData::collectSelectorHashes(const CSSSelector& selector, bool isAncestor, unsigned& index)
 {
     assert(!selector.empty());
     auto it = selector.begin();
     auto end = selector.end();
-
-    unsigned index = 0;
-    do {
+    collectCompoundSelectorHashes(it->compoundSelector(), isAncestor, index);
+    while(true) {
         auto combinator = it->combinator();
-        ++it;
-        if(combinator == CSSComplexSelector::Combinator::Child
-            || combinator == CSSComplexSelector::Combinator::Descendant) {
-            for(const auto& sel : it->compoundSelector()) {
-                if(index == maxHashCount)
-                    return;
-                switch(sel.matchType()) {
-                case CSSSimpleSelector::MatchType::Tag:
-                    m_hashes[index++] = hashString(sel.name());
-                    break;
-                case CSSSimpleSelector::MatchType::Id:
-                case CSSSimpleSelector::MatchType::Class:
-                    m_hashes[index++] = hashString(sel.value());
-                    break;
-                default:
-                    break;
+        if(++it == end)
+            break;
+        collectCompoundSelectorHashes(it->compoundSelector(), combinator == CSSComplexSelector::Combinator::Child
+            || combinator == CSSComplexSelector::Combinator::Descendant, index);
+    }
+}
+
+void CSSRuleData::collectCompoundSelectorHashes(const CSSCompoundSelector& selector, bool isAncestor, unsigned& index)
+{
+    for(const auto& sel : selector) {
+        if(index == maxHashCount)
+            return;
+        switch(sel.matchType()) {
+        case CSSSimpleSelector::MatchType::Tag:
+            if(isAncestor)
+                m_hashes[index++] = hashString(sel.name());
+            break;
+        case CSSSimpleSelector::MatchType::Id:
+        case CSSSimpleSelector::MatchType::Class:
+            if(isAncestor)
+                m_hashes[index++] = hashString(sel.value());
+            break;
+        case CSSSimpleSelector::MatchType::AttributeContains:
+        case CSSSimpleSelector::MatchType::AttributeDashEquals:
+        case CSSSimpleSelector::MatchType::AttributeEndsWith:
+        case CSSSimpleSelector::MatchType::AttributeEquals:
+        case CSSSimpleSelector::MatchType::AttributeHas:
+        case CSSSimpleSelector::MatchType::AttributeIncludes:
+        case CSSSimpleSelector::MatchType::AttributeStartsWith:
+            if(isAncestor)
+                m_hashes[index++] = hashString(sel.name().foldCase()) * SelectorFilter::attributeSalt;
+            break;
+        case CSSSimpleSelector::MatchType::PseudoClassIs:
+        case CSSSimpleSelector::MatchType::PseudoClassWhere: {
+            const auto& subSelectors = sel.subSelectors();
+            if(!subSelectors.empty() && std::next(subSelectors.begin()) == subSelectors.end())
+                collectSelectorHashes(subSelectors.front(), isAncestor, index);
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+}
+
+bool CSSRuleData::isStructuralSelector(const CSSSelector& selector)
+{
+    for(const auto& complexSelector : selector) {
+        switch(complexSelector.combinator()) {
+        case CSSComplexSelector::Combinator::DirectAdjacent:
+        case CSSComplexSelector::Combinator::InDirectAdjacent:
+            return true;
+        default:
+            break;
+        }
+
+        for(const auto& simpleSelector : complexSelector.compoundSelector()) {
+            switch(simpleSelector.matchType()) {
+            case CSSSimpleSelector::MatchType::PseudoClassEmpty:
+            case CSSSimpleSelector::MatchType::PseudoClassHas:
+            case CSSSimpleSelector::MatchType::PseudoClassFirstChild:
+            case CSSSimpleSelector::MatchType::PseudoClassLastChild:
+            case CSSSimpleSelector::MatchType::PseudoClassOnlyChild:
+            case CSSSimpleSelector::MatchType::PseudoClassFirstOfType:
+            case CSSSimpleSelector::MatchType::PseudoClassLastOfType:
+            case CSSSimpleSelector::MatchType::PseudoClassOnlyOfType:
+            case CSSSimpleSelector::MatchType::PseudoClassNthChild:
+            case CSSSimpleSelector::MatchType::PseudoClassNthLastChild:
+            case CSSSimpleSelector::MatchType::PseudoClassNthOfType:
+            case CSSSimpleSelector::MatchType::PseudoClassNthLastOfType:
+            case CSSSimpleSelector::MatchType::PseudoClassFocusWithin:
+            case CSSSimpleSelector::MatchType::PseudoClassTargetWithin:
+                return true;
+            case CSSSimpleSelector::MatchType::PseudoClassIs:
+            case CSSSimpleSelector::MatchType::PseudoClassWhere:
+            case CSSSimpleSelector::MatchType::PseudoClassNot:
+                for(const auto& subSelector : simpleSelector.subSelectors()) {
+                    if(isStructuralSelector(subSelector)) {
+                        return true;
+                    }
                 }
+
+                break;
+            default:
+                break;
             }
         }
-    } while(it != end);
-    if(index < maxHashCount) {
-        m_hashes[index] = 0;
     }
+
+    return false;
 }
 
 bool CSSRuleData::match(const Element* element, PseudoType pseudoType, const SelectorFilter& selectorFilter) const
@@ -194,10 +291,12 @@ bool CSSRuleData::match(const Element* element, PseudoType pseudoType, const Sel
         if(hash == 0)
             break;
         if(!selectorFilter.contains(hash)) {
+            selectorFilter.m_rejectCount++;
             return false;
         }
     }
 
+    selectorFilter.m_matchCount++;
     return matchSelector(element, pseudoType, m_selector);
 }
 
@@ -435,7 +534,53 @@ bool CSSRuleData::matchPseudoClassNotSelector(const Element* element, const CSSS
     return !matchPseudoClassIsSelector(element, selector);
 }
 
+static uint64_t compoundSelectorFeatureMask(const CSSCompoundSelector& selector)
+{
+    uint64_t mask = 0;
+    for(const auto& sel : selector) {
+        switch(sel.matchType()) {
+        case CSSSimpleSelector::MatchType::Tag:
+            mask |= Element::featureBit(sel.name().foldCase());
+            break;
+        case CSSSimpleSelector::MatchType::Id:
+        case CSSSimpleSelector::MatchType::Class:
+            mask |= Element::featureBit(sel.value());
+            break;
+        default:
+            break;
+        }
+    }
+
+    return mask;
+}
+
+static std::unique_lock<std::mutex> lockHasSelectorResults(Document* document)
+{
+    if(document->isMatchingRulesInParallel())
+        return std::unique_lock(document->hasSelectorMutex());
+    return std::unique_lock<std::mutex>();
+}
+
 bool CSSRuleData::matchPseudoClassHasSelector(const Element* element, const CSSSimpleSelector& selector)
+{
+    auto document = element->document();
+    auto key = std::make_pair(element, &selector);
+    {
+        auto guard = lockHasSelectorResults(document);
+        const auto& results = document->hasSelectorResults();
+        auto it = results.find(key);
+        if(it != results.end()) {
+            return it->second;
+        }
+    }
+
+    auto result = matchPseudoClassHasArguments(element, selector);
+    auto guard = lockHasSelectorResults(document);
+    document->hasSelectorResults().emplace(key, result);
+    return result;
+}
+
+bool CSSRuleData::matchPseudoClassHasArguments(const Element* element, const CSSSimpleSelector& selector)
 {
     for(const auto& subSelector : selector.subSelectors()) {
         int maxDepth = 0;
@@ -447,6 +592,14 @@ bool CSSRuleData::matchPseudoClassHasSelector(const Element* element, const CSSS
 
         if(combinator == CSSComplexSelector::Combinator::None)
             combinator = CSSComplexSelector::Combinator::Descendant;
+        if(combinator == CSSComplexSelector::Combinator::Descendant
+            || combinator == CSSComplexSelector::Combinator::Child) {
+            auto mask = compoundSelectorFeatureMask(subSelector.front().compoundSelector());
+            if((element->descendantFeatureMask() & mask) != mask) {
+                continue;
+            }
+        }
+
         auto checkDescendants = [&](const Element* descendant) {
             int depth = 0;
             do {
@@ -564,24 +717,12 @@ bool CSSRuleData::matchPseudoClassOnlyChildSelector(const Element* element, cons
 
 bool CSSRuleData::matchPseudoClassFirstOfTypeSelector(const Element* element, const CSSSimpleSelector& selector)
 {
-    for(auto sibling = element->previousSiblingElement(); sibling; sibling = sibling->previousSiblingElement()) {
-        if(sibling->isOfType(element->namespaceURI(), element->tagName())) {
-            return false;
-        }
-    }
-
-    return true;
+    return element->siblingIndexOfType() == 1;
 }
 
 bool CSSRuleData::matchPseudoClassLastOfTypeSelector(const Element* element, const CSSSimpleSelector& selector)
 {
-    for(auto sibling = element->nextSiblingElement(); sibling; sibling = sibling->nextSiblingElement()) {
-        if(sibling->isOfType(element->namespaceURI(), element->tagName())) {
-            return false;
-        }
-    }
-
-    return true;
+    return element->siblingIndexOfTypeFromEnd() == 1;
 }
 
 bool CSSRuleData::matchPseudoClassOnlyOfTypeSelector(const Element* element, const CSSSimpleSelector& selector)
@@ -591,42 +732,22 @@ bool CSSRuleData::matchPseudoClassOnlyOfTypeSelector(const Element* element, con
 
 bool CSSRuleData::matchPseudoClassNthChildSelector(const Element* element, const CSSSimpleSelector& selector)
 {
-    int index = 0;
-    for(auto sibling = element->previousSiblingElement(); sibling; sibling = sibling->previousSiblingElement())
-        ++index;
-    return selector.matchNth(index + 1);
+    return selector.matchNth(element->siblingIndex());
 }
 
 bool CSSRuleData::matchPseudoClassNthLastChildSelector(const Element* element, const CSSSimpleSelector& selector)
 {
-    int index = 0;
-    for(auto sibling = element->nextSiblingElement(); sibling; sibling = sibling->nextSiblingElement())
-        ++index;
-    return selector.matchNth(index + 1);
+    return selector.matchNth(element->siblingIndexFromEnd());
 }
 
 bool CSSRuleData::matchPseudoClassNthOfTypeSelector(const Element* element, const CSSSimpleSelector& selector)
 {
-    int index = 0;
-    for(auto sibling = element->previousSiblingElement(); sibling; sibling = sibling->previousSiblingElement()) {
-        if(sibling->isOfType(element->namespaceURI(), element->tagName())) {
-            ++index;
-        }
-    }
-
-    return selector.matchNth(index + 1);
+    return selector.matchNth(element->siblingIndexOfType());
 }
 
 bool CSSRuleData::matchPseudoClassNthLastOfTypeSelector(const Element* element, const CSSSimpleSelector& selector)
 {
-    int index = 0;
-    for(auto sibling = element->nextSiblingElement(); sibling; sibling = sibling->nextSiblingElement()) {
-        if(sibling->isOfType(element->namespaceURI(), element->tagName())) {
-            ++index;
-        }
-    }
-
-    return selector.matchNth(index + 1);
+    return selector.matchNth(element->siblingIndexOfTypeFromEnd());
 }
 
 bool CSSPageRuleData::match(const GlobalString& pageName, uint32_t pageIndex, PseudoType pseudoType) const
@@ -15,6 +15,7 @@
 #include <forward_list>
 #include <memory>
 #include <variant>
+#include <atomic>
 
 namespace plutobook {
 
@@ -180,22 +181,56 @@ public:
 
 using CSSRuleList = std::pmr::vector<RefPtr<CSSRule>>;
 
+class CSSRuleParserContext : public HeapMember, public RefCounted<CSSRuleParserContext> {
+public:
+    static RefPtr<CSSRuleParserContext> create(Heap* heap, const CSSParserContext& context);
+
+    Heap* heap() const { return m_heap; }
+    const CSSParserContext& context() const { return m_context; }
+
+private:
+    CSSRuleParserContext(Heap* heap, const CSSParserContext& context)
+        : m_heap(heap), m_context(context)
+    {}
+
+    Heap* m_heap;
+    CSSParserContext m_context;
+};
+
+inline RefPtr<CSSRuleParserContext> CSSRuleParserContext::create(Heap* heap, const CSSParserContext& context)
+{
+    return adoptPtr(new (heap) CSSRuleParserContext(heap, context));
+}
+
 class CSSStyleRule final : public CSSRule {
 public:
     static RefPtr<CSSStyleRule> create(Heap* heap, CSSSelectorList selectors, CSSPropertyList properties);
+    static RefPtr<CSSStyleRule> create(Heap* heap, CSSSelectorList selectors, RefPtr<CSSRuleParserContext> context, const HeapString& declarations);
 
     const CSSSelectorList& selectors() const { return m_selectors; }
-    const CSSPropertyList& properties() const { return m_properties; }
+    const CSSPropertyList& properties() const;
     CSSRuleType type() const final { return CSSRuleType::Style; }
 
 private:
     CSSStyleRule(CSSSelectorList selectors, CSSPropertyList properties)
         : m_selectors(std::move(selectors))
         , m_properties(std::move(properties))
+        , m_hasProperties(true)
+    {}
+
+    CSSStyleRule(Heap* heap, CSSSelectorList selectors, RefPtr<CSSRuleParserContext> context, const HeapString& declarations)
+        : m_selectors(std::move(selectors))
+        , m_properties(heap)
+        , m_context(std::move(context))
+        , m_declarations(declarations)
+        , m_hasProperties(false)
     {}
 
     CSSSelectorList m_selectors;
-    CSSPropertyList m_properties;
+    mutable CSSPropertyList m_properties;
+    RefPtr<CSSRuleParserContext> m_context;
+    HeapString m_declarations;
+    mutable std::atomic_bool m_hasProperties;
 };
 
 inline RefPtr<CSSStyleRule> CSSStyleRule::create(Heap* heap, CSSSelectorList selectors, CSSPropertyList properties)
@@ -203,6 +238,11 @@ inline RefPtr<CSSStyleRule> CSSStyleRule::create(Heap* heap, CSSSelectorList sel
     return adoptPtr(new (heap) CSSStyleRule(std::move(selectors), std::move(properties)));
 }
 
+inline RefPtr<CSSStyleRule> CSSStyleRule::create(Heap* heap, CSSSelectorList selectors, RefPtr<CSSRuleParserContext> context, const HeapString& declarations)
+{
+    return adoptPtr(new (heap) CSSStyleRule(heap, std::move(selectors), std::move(context), declarations));
+}
+
 template<>
 struct is_a<CSSStyleRule> {
     static bool check(const CSSRule& value) { return value.type() == CSSRuleType::Style; }
@@ -479,6 +519,9 @@ public:
     void push(const Element* element);
     void pop();
 
+    uint32_t rejectCount() const { return m_rejectCount; }
+    uint32_t matchCount() const { return m_matchCount; }
+
 private:
     bool contains(unsigned hash) const { return isSet(hash) && isSet(hash >> 16); }
 
@@ -493,11 +536,14 @@ private:
     static const unsigned keyBits = 12;
     static const unsigned keyMask = (1 << keyBits) - 1;
     static const unsigned maxCount = (1 << 8) - 1;
+    static const unsigned attributeSalt = 13;
 
     using HashVector = std::vector<unsigned>;
 
     std::unique_ptr<uint8_t[]> m_table;
     std::vector<HashVector> m_stack;
+    mutable uint32_t m_rejectCount{0};
+    mutable uint32_t m_matchCount{0};
 
     friend class CSSRuleData;
 };
@@ -533,17 +579,22 @@ inline void SelectorFilter::unset(unsigned key)
 
 class CSSRuleData {
 public:
-    CSSRuleData(CSSStyleRule& rule, const CSSSelector& selector, uint32_t specificity, uint32_t position);
+    CSSRuleData(CSSStyleRule& rule, const CSSSelector& selector, PseudoType pseudoType, uint32_t specificity, uint32_t position);
 
     const RefPtr<CSSStyleRule>& rule() const { return m_rule; }
     const CSSSelector& selector() const { return m_selector; }
     const CSSPropertyList& properties() const { return m_rule->properties(); }
     const uint32_t specificity() const { return m_specificity; }
     const uint32_t position() const { return m_position; }
+    PseudoType pseudoType() const { return m_pseudoType; }
+    bool preventsStyleSharing() const { return m_preventsStyleSharing; }
 
     bool match(const Element* element, PseudoType pseudoType, const SelectorFilter& selectorFilter) const;
 
 private:
+    static bool isStructuralSelector(const CSSSelector& selector);
+    void collectSelectorHashes(const CSSSelector& selector, bool isAncestor, unsigned& index);
+    void collectCompoundSelectorHashes(const CSSCompoundSelector& selector, bool isAncestor, unsigned& index);
     static bool matchSelector(const Element* element, PseudoType pseudoType, const CSSSelector& selector);
     static bool matchCompoundSelector(const Element* element, PseudoType pseudoType, const CSSCompoundSelector& selector);
     static bool matchSimpleSelector(const Element* element, const CSSSimpleSelector& selector);
@@ -564,6 +615,7 @@ private:
     static bool matchPseudoClassIsSelector(const Element* element, const CSSSimpleSelector& selector);
     static bool matchPseudoClassNotSelector(const Element* element, const CSSSimpleSelector& selector);
     static bool matchPseudoClassHasSelector(const Element* element, const CSSSimpleSelector& selector);
+    static bool matchPseudoClassHasArguments(const Element* element, const CSSSimpleSelector& selector);
 
     static bool matchPseudoClassLinkSelector(const Element* element, const CSSSimpleSelector& selector);
     static bool matchPseudoClassLocalLinkSelector(const Element* element, const CSSSimpleSelector& selector);
@@ -595,6 +647,8 @@ private:
     const CSSSelector& m_selector;
     uint32_t m_specificity;
     uint32_t m_position;
+    PseudoType m_pseudoType;
+    bool m_preventsStyleSharing;
     unsigned m_hashes[maxHashCount];
 };
 
@@ -532,31 +532,25 @@ FontDescription StyleBuilder::fontDescription() const
 
 class ElementStyleBuilder final : public StyleBuilder {
 public:
-    ElementStyleBuilder(Element* element, PseudoType pseudoType, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle);
+    ElementStyleBuilder(Element* element, PseudoType pseudoType, const BoxStyle* parentStyle);
 
-    void add(const CSSRuleDataList* rules);
+    void add(const CSSRuleDataRefList& rules);
     RefPtr<BoxStyle> build();
 
 private:
     Element* m_element;
-    const SelectorFilter& m_selectorFilter;
 };
 
-ElementStyleBuilder::ElementStyleBuilder(Element* element, PseudoType pseudoType, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle)
+ElementStyleBuilder::ElementStyleBuilder(Element* element, PseudoType pseudoType, const BoxStyle* parentStyle)
     : StyleBuilder(parentStyle, pseudoType)
     , m_element(element)
-    , m_selectorFilter(selectorFilter)
 {
 }
 
-void ElementStyleBuilder::add(const CSSRuleDataList* rules)
+void ElementStyleBuilder::add(const CSSRuleDataRefList& rules)
 {
-    if(rules) {
-        for(const auto& rule : *rules) {
-            if(rule.match(m_element, m_pseudoType, m_selectorFilter)) {
-                merge(rule.specificity(), rule.position(), rule.properties());
-            }
-        }
+    for(const auto* rule : rules) {
+        merge(rule->specificity(), rule->position(), rule->properties());
     }
 }
 
@@ -749,14 +743,135 @@ RefPtr<BoxStyle> PageStyleBuilder::build()
     return newStyle;
 }
 
+RefPtr<BoxStyle> CSSStyleSharingCache::find(const Element* element, const BoxStyle* parentStyle)
+{
+    for(const auto& entry : m_entries) {
+        if(entry.style && entry.style->parentStyle() == parentStyle && canShareStyle(element, entry.element)) {
+            ++m_hitCount;
+            return entry.style;
+        }
+    }
+
+    ++m_missCount;
+    return nullptr;
+}
+
+void CSSStyleSharingCache::add(const Element* element, RefPtr<BoxStyle> style)
+{
+    auto& entry = m_entries[m_nextEntry];
+    entry.element = element;
+    entry.style = std::move(style);
+    m_nextEntry = (m_nextEntry + 1) % maxEntryCount;
+}
+
+bool CSSStyleSharingCache::canShareStyle(const Element* a, const Element* b)
+{
+    if(a->isRootNode() || !a->id().empty() || !b->id().empty())
+        return false;
+    if(a->tagName() != b->tagName() || a->namespaceURI() != b->namespaceURI())
+        return false;
+    if(a->isCaseSensitive() != b->isCaseSensitive())
+        return false;
+    return a->classNames() == b->classNames() && a->attributes() == b->attributes();
+}
+
+void CSSPseudoRuleMatches::add(const CSSRuleData* rule, PseudoType pseudoType)
+{
+    assert(pseudoType > PseudoType::None && index(pseudoType) < maxPseudoTypeCount);
+    m_pseudoTypes |= 1 << index(pseudoType);
+    m_rules[index(pseudoType)].push_back(rule);
+}
+
+CSSRuleDataSet::CSSRuleDataSet(Heap* heap)
+    : m_idRules(heap)
+    , m_classRules(heap)
+    , m_tagRules(heap)
+    , m_attributeRules(heap)
+    , m_pseudoIdRules(heap)
+    , m_pseudoClassRules(heap)
+    , m_pseudoTagRules(heap)
+    , m_pseudoAttributeRules(heap)
+    , m_universalRules(heap)
+    , m_universalPseudoRules(heap)
+{
+}
+
+void CSSRuleDataSet::addStyleRule(CSSStyleRule& rule, uint32_t position)
+{
+    for(const auto& selector : rule.selectors()) {
+        uint32_t specificity = 0;
+        for(const auto& complexSelector : selector) {
+            specificity += complexSelector.specificity();
+        }
+
+        HeapString idName;
+        HeapString className;
+        GlobalString tagName;
+        GlobalString attrName;
+        PseudoType pseudoType = PseudoType::None;
+        const auto& lastComplexSelector = selector.front();
+        for(const auto& simpleSelector : lastComplexSelector.compoundSelector()) {
+            switch(simpleSelector.matchType()) {
+            case CSSSimpleSelector::MatchType::Id:
+                idName = simpleSelector.value();
+                break;
+            case CSSSimpleSelector::MatchType::Class:
+                className = simpleSelector.value();
+                break;
+            case CSSSimpleSelector::MatchType::Tag:
+                tagName = simpleSelector.name();
+                break;
+            case CSSSimpleSelector::MatchType::AttributeContains:
+            case CSSSimpleSelector::MatchType::AttributeDashEquals:
+            case CSSSimpleSelector::MatchType::AttributeEndsWith:
+            case CSSSimpleSelector::MatchType::AttributeEquals:
+            case CSSSimpleSelector::MatchType::AttributeHas:
+            case CSSSimpleSelector::MatchType::AttributeIncludes:
+            case CSSSimpleSelector::MatchType::AttributeStartsWith:
+                attrName = simpleSelector.name();
+                break;
+            case CSSSimpleSelector::MatchType::PseudoElementBefore:
+            case CSSSimpleSelector::MatchType::PseudoElementAfter:
+            case CSSSimpleSelector::MatchType::PseudoElementMarker:
+            case CSSSimpleSelector::MatchType::PseudoElementFirstLetter:
+            case CSSSimpleSelector::MatchType::PseudoElementFirstLine:
+                pseudoType = simpleSelector.pseudoType();
+                break;
+            default:
+                break;
+            }
+        }
+
+        CSSRuleData ruleData(rule, selector, pseudoType, specificity, position);
+        if(pseudoType > PseudoType::None) {
+            if(!idName.empty()) {
+                m_pseudoIdRules.add(idName, std::move(ruleData));
+            } else if(!className.empty()) {
+                m_pseudoClassRules.add(className, std::move(ruleData));
+            } else if(!attrName.isEmpty()) {
+                m_pseudoAttributeRules.add(attrName, std::move(ruleData));
+            } else if(!tagName.isEmpty()) {
+                m_pseudoTagRules.add(tagName, std::move(ruleData));
+            } else {
+                m_universalPseudoRules.push_back(std::move(ruleData));
+            }
+        } else if(!idName.empty()) {
+            m_idRules.add(idName, std::move(ruleData));
+        } else if(!className.empty()) {
+            m_classRules.add(className, std::move(ruleData));
+        } else if(!attrName.isEmpty()) {
+            m_attributeRules.add(attrName, std::move(ruleData));
+        } else if(!tagName.isEmpty()) {
+            m_tagRules.add(tagName, std::move(ruleData));
+        } else {
+            m_universalRules.push_back(std::move(ruleData));
+        }
+    }
+}
+
 CSSStyleSheet::CSSStyleSheet(Document* document)
     : m_document(document)
-    , m_idRules(document->heap())
-    , m_classRules(document->heap())
-    , m_tagRules(document->heap())
-    , m_attributeRules(document->heap())
-    , m_pseudoRules(document->heap())
-    , m_universalRules(document->heap())
+    , m_authorRules(document->heap())
     , m_pageRules(document->heap())
     , m_fontFaces(document->heap())
 {
@@ -766,22 +881,99 @@ CSSStyleSheet::~CSSStyleSheet() = default;
 
 RefPtr<BoxStyle> CSSStyleSheet::styleForElement(Element* element, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle) const
 {
-    ElementStyleBuilder builder(element, PseudoType::None, selectorFilter, parentStyle);
+    if(auto style = m_styleSharingCache.find(element, parentStyle))
+        return style;
+    return buildElementStyle(element, rulesForElement(element, selectorFilter), parentStyle);
+}
+
+RefPtr<BoxStyle> CSSStyleSheet::styleForElement(Element* element, const CSSElementRuleMatches& matches, const BoxStyle* parentStyle) const
+{
+    if(auto style = m_styleSharingCache.find(element, parentStyle))
+        return style;
+    return buildElementStyle(element, matches, parentStyle);
+}
+
+RefPtr<BoxStyle> CSSStyleSheet::buildElementStyle(Element* element, const CSSElementRuleMatches& matches, const BoxStyle* parentStyle) const
+{
+    ElementStyleBuilder builder(element, PseudoType::None, parentStyle);
+    builder.add(matches.rules);
+    auto style = builder.build();
+    if(matches.canShareStyle && style->position() != Position::Running)
+        m_styleSharingCache.add(element, style);
+    return style;
+}
+
+RefPtr<BoxStyle> CSSStyleSheet::pseudoStyleForElement(Element* element, PseudoType pseudoType, const CSSPseudoRuleMatches& matches, const BoxStyle* parentStyle) const
+{
+    if(pseudoType != PseudoType::Marker && !matches.contains(pseudoType))
+        return nullptr;
+    ElementStyleBuilder builder(element, pseudoType, parentStyle);
+    builder.add(matches.get(pseudoType));
+    return builder.build();
+}
+
+static void matchPseudoRules(Element* element, const CSSRuleDataList* rules, const SelectorFilter& selectorFilter, CSSPseudoRuleMatches& matches)
+{
+    if(rules) {
+        for(const auto& rule : *rules) {
+            if(rule.match(element, rule.pseudoType(), selectorFilter)) {
+                matches.add(&rule, rule.pseudoType());
+            }
+        }
+    }
+}
+
+static void matchPseudoRules(Element* element, const CSSRuleDataSet& rules, const SelectorFilter& selectorFilter, CSSPseudoRuleMatches& matches)
+{
     for(const auto& className : element->classNames())
-        builder.add(m_classRules.get(className));
+        matchPseudoRules(element, rules.pseudoClassRules(className), selectorFilter, matches);
     for(const auto& attribute : element->attributes())
-        builder.add(m_attributeRules.get(element->foldCase(attribute.name())));
-    builder.add(m_tagRules.get(element->foldTagNameCase()));
-    builder.add(m_idRules.get(element->id()));
-    builder.add(&m_universalRules);
-    return builder.build();
+        matchPseudoRules(element, rules.pseudoAttributeRules(element->foldCase(attribute.name())), selectorFilter, matches);
+    matchPseudoRules(element, rules.pseudoTagRules(element->foldTagNameCase()), selectorFilter, matches);
+    matchPseudoRules(element, rules.pseudoIdRules(element->id()), selectorFilter, matches);
+    matchPseudoRules(element, rules.universalPseudoRules(), selectorFilter, matches);
 }
 
-RefPtr<BoxStyle> CSSStyleSheet::pseudoStyleForElement(Element* element, PseudoType pseudoType, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle) const
+CSSPseudoRuleMatches CSSStyleSheet::pseudoRulesForElement(Element* element, const SelectorFilter& selectorFilter) const
 {
-    ElementStyleBuilder builder(element, pseudoType, selectorFilter, parentStyle);
-    builder.add(m_pseudoRules.get(pseudoType));
-    return builder.build();
+    CSSPseudoRuleMatches matches;
+    if(m_userAgentRules)
+        matchPseudoRules(element, *m_userAgentRules, selectorFilter, matches);
+    matchPseudoRules(element, m_authorRules, selectorFilter, matches);
+    return matches;
+}
+
+static void matchRules(Element* element, const CSSRuleDataList* rules, const SelectorFilter& selectorFilter, CSSElementRuleMatches& matches)
+{
+    if(rules) {
+        for(const auto& rule : *rules) {
+            if(rule.preventsStyleSharing())
+                matches.canShareStyle = false;
+            if(rule.match(element, PseudoType::None, selectorFilter)) {
+                matches.rules.push_back(&rule);
+            }
+        }
+    }
+}
+
+static void matchRules(Element* element, const CSSRuleDataSet& rules, const SelectorFilter& selectorFilter, CSSElementRuleMatches& matches)
+{
+    for(const auto& className : element->classNames())
+        matchRules(element, rules.classRules(className), selectorFilter, matches);
+    for(const auto& attribute : element->attributes())
+        matchRules(element, rules.attributeRules(element->foldCase(attribute.name())), selectorFilter, matches);
+    matchRules(element, rules.tagRules(element->foldTagNameCase()), selectorFilter, matches);
+    matchRules(element, rules.idRules(element->id()), selectorFilter, matches);
+    matchRules(element, rules.universalRules(), selectorFilter, matches);
+}
+
+CSSElementRuleMatches CSSStyleSheet::rulesForElement(Element* element, const SelectorFilter& selectorFilter) const
+{
+    CSSElementRuleMatches matches;
+    if(m_userAgentRules)
+        matchRules(element, *m_userAgentRules, selectorFilter, matches);
+    matchRules(element, m_authorRules, selectorFilter, matches);
+    return matches;
 }
 
 RefPtr<BoxStyle> CSSStyleSheet::styleForPage(const GlobalString& pageName, uint32_t pageIndex, PseudoType pseudoType) const
@@ -846,6 +1038,102 @@ std::string CSSStyleSheet::getMarkerText(int value, const GlobalString& listType
     return representation;
 }
 
+CSSCachedStyleSheet::CSSCachedStyleSheet(std::string_view content, const CSSParserContext& context)
+    : m_heap(1024 * 16)
+    , m_content(m_heap.createString(content))
+    , m_rules(&m_heap)
+    , m_origin(context.origin())
+    , m_inHTMLDocument(context.inHTMLDocument())
+{
+    CSSParser parser(context, &m_heap);
+    m_rules = parser.parseSheet(m_content);
+}
+
+size_t CSSStyleSheetCache::KeyHash::operator()(const Key& key) const
+{
+    auto hash = std::hash<std::string>()(key.url);
+    auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+    combine(key.contentHash);
+    combine(static_cast<size_t>(key.origin));
+    combine(key.inHTMLDocument);
+    return hash;
+}
+
+constexpr size_t kMaxCachedStyleSheets = 256;
+
+std::shared_ptr<const CSSCachedStyleSheet> CSSStyleSheetCache::parseSheet(std::string_view content, const CSSParserContext& context)
+{
+    if(!m_enabled)
+        return nullptr;
+    Key key{std::string(context.baseUrl().value()), std::hash<std::string_view>()(content), context.origin(), context.inHTMLDocument()};
+    {
+        std::lock_guard guard(m_mutex);
+        auto it = m_table.find(key);
+        if(it != m_table.end() && it->second.styleSheet->content() == content) {
+            m_order.splice(m_order.begin(), m_order, it->second.position);
+            return it->second.styleSheet;
+        }
+    }
+
+    auto newStyleSheet = std::make_shared<const CSSCachedStyleSheet>(content, context);
+    std::lock_guard guard(m_mutex);
+    auto [it, inserted] = m_table.try_emplace(std::move(key));
+    if(inserted) {
+        m_order.push_front(&it->first);
+        it->second.position = m_order.begin();
+    } else {
+        m_order.splice(m_order.begin(), m_order, it->second.position);
+        if(it->second.styleSheet->content() == content) {
+            return it->second.styleSheet;
+        }
+    }
+
+    it->second.styleSheet = newStyleSheet;
+    trim(kMaxCachedStyleSheets);
+    return newStyleSheet;
+}
+
+void CSSStyleSheetCache::evict(std::string_view url)
+{
+    std::lock_guard guard(m_mutex);
+    for(auto it = m_order.begin(); it != m_order.end();) {
+        const auto* key = *it;
+        if(key->url == url) {
+            it = m_order.erase(it);
+            m_table.erase(*key);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CSSStyleSheetCache::clear()
+{
+    std::lock_guard guard(m_mutex);
+    m_table.clear();
+    m_order.clear();
+}
+
+void CSSStyleSheetCache::trim(size_t capacity)
+{
+    while(m_table.size() > capacity) {
+        m_table.erase(*m_order.back());
+        m_order.pop_back();
+    }
+}
+
+CSSStyleSheetCache* styleSheetCache()
+{
+    static CSSStyleSheetCache styleSheetCache;
+    return &styleSheetCache;
+}
+
+void CSSStyleSheet::addSelectorFilterCounts(const SelectorFilter& selectorFilter) const
+{
+    m_selectorFilterRejectCount += selectorFilter.rejectCount();
+    m_selectorFilterMatchCount += selectorFilter.matchCount();
+}
+
 void CSSStyleSheet::parseStyle(std::string_view content, CSSStyleOrigin origin, Url baseUrl)
 {
     if(content.empty())
@@ -855,6 +1143,21 @@ void CSSStyleSheet::parseStyle(std::string_view content, CSSStyleOrigin origin,
     addRules(parser.parseSheet(content));
 }
 
+void CSSStyleSheet::parseExternalStyle(std::string_view content, CSSStyleOrigin origin, Url url)
+{
+    if(content.empty())
+        return;
+    CSSParserContext context(m_document, origin, std::move(url));
+    if(auto styleSheet = styleSheetCache()->parseSheet(content, context)) {
+        addRules(styleSheet->rules());
+        m_document->heap()->retain(std::move(styleSheet));
+        return;
+    }
+
+    CSSParser parser(context, m_document->heap());
+    addRules(parser.parseSheet(content));
+}
+
 void CSSStyleSheet::addRules(const CSSRuleList& rules)
 {
     for(const auto& rule : rules) {
@@ -887,65 +1190,7 @@ void CSSStyleSheet::addRules(const CSSRuleList& rules)
 
 void CSSStyleSheet::addStyleRule(CSSStyleRule& rule)
 {
-    for(const auto& selector : rule.selectors()) {
-        uint32_t specificity = 0;
-        for(const auto& complexSelector : selector) {
-            specificity += complexSelector.specificity();
-        }
-
-        HeapString idName;
-        HeapString className;
-        GlobalString tagName;
-        GlobalString attrName;
-        PseudoType pseudoType = PseudoType::None;
-        const auto& lastComplexSelector = selector.front();
-        for(const auto& simpleSelector : lastComplexSelector.compoundSelector()) {
-            switch(simpleSelector.matchType()) {
-            case CSSSimpleSelector::MatchType::Id:
-                idName = simpleSelector.value();
-                break;
-            case CSSSimpleSelector::MatchType::Class:
-                className = simpleSelector.value();
-                break;
-            case CSSSimpleSelector::MatchType::Tag:
-                tagName = simpleSelector.name();
-                break;
-            case CSSSimpleSelector::MatchType::AttributeContains:
-            case CSSSimpleSelector::MatchType::AttributeDashEquals:
-            case CSSSimpleSelector::MatchType::AttributeEndsWith:
-            case CSSSimpleSelector::MatchType::AttributeEquals:
-            case CSSSimpleSelector::MatchType::AttributeHas:
-            case CSSSimpleSelector::MatchType::AttributeIncludes:
-            case CSSSimpleSelector::MatchType::AttributeStartsWith:
-                attrName = simpleSelector.name();
-                break;
-            case CSSSimpleSelector::MatchType::PseudoElementBefore:
-            case CSSSimpleSelector::MatchType::PseudoElementAfter:
-            case CSSSimpleSelector::MatchType::PseudoElementMarker:
-            case CSSSimpleSelector::MatchType::PseudoElementFirstLetter:
-            case CSSSimpleSelector::MatchType::PseudoElementFirstLine:
-                pseudoType = simpleSelector.pseudoType();
-                break;
-            default:
-                break;
-            }
-        }
-
-        CSSRuleData ruleData(rule, selector, specificity, m_ruleCount);
-        if(pseudoType > PseudoType::None) {
-            m_pseudoRules.add(pseudoType, std::move(ruleData));
-        } else if(!idName.empty()) {
-            m_idRules.add(idName, std::move(ruleData));
-        } else if(!className.empty()) {
-            m_classRules.add(className, std::move(ruleData));
-        } else if(!attrName.isEmpty()) {
-            m_attributeRules.add(attrName, std::move(ruleData));
-        } else if(!tagName.isEmpty()) {
-            m_tagRules.add(tagName, std::move(ruleData));
-        } else {
-            m_universalRules.push_back(std::move(ruleData));
-        }
-    }
+    m_authorRules.addStyleRule(rule, m_ruleCount);
 }
 
 void CSSStyleSheet::addImportRule(CSSImportRule& rule)
@@ -954,7 +1199,7 @@ void CSSStyleSheet::addImportRule(CSSImportRule& rule)
     if(m_importDepth < kMaxImportDepth && m_document->supportsMediaQueries(rule.queries())) {
         if(auto resource = m_document->fetchTextResource(rule.href())) {
             m_importDepth++;
-            parseStyle(resource->text(), rule.origin(), rule.href());
+            parseExternalStyle(resource->text(), rule.origin(), rule.href());
             m_importDepth--;
         }
     }
@@ -1244,11 +1489,34 @@ static const CSSRuleList& userAgentRules()
     return rules;
 }
 
+static const CSSRuleDataSet& userAgentRuleDataSet()
+{
+    static Heap heap(1024 * 64);
+    static const CSSRuleDataSet ruleDataSet = []() {
+        CSSRuleDataSet ruleDataSet(&heap);
+        uint32_t position = 0;
+        for(const auto& rule : userAgentRules()) {
+            if(rule->type() == CSSRuleType::Style)
+                ruleDataSet.addStyleRule(to<CSSStyleRule>(*rule), position);
+            position += 1;
+        }
+
+        return ruleDataSet;
+    }();
+
+    return ruleDataSet;
+}
+
 void CSSStyleSheet::addUserAgentRules()
 {
     assert(m_ruleCount == 0);
-    if(m_document->isRootDocument()) {
-        addRules(userAgentRules());
+    if(!m_document->isRootDocument())
+        return;
+    m_userAgentRules = &userAgentRuleDataSet();
+    for(const auto& rule : userAgentRules()) {
+        if(rule->type() == CSSRuleType::Page)
+            addPageRule(to<CSSPageRule>(*rule));
+        m_ruleCount += 1;
     }
 }
 
@@ -17,6 +17,12 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <unordered_map>
+#include <list>
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <mutex>
 
 namespace plutobook {
 
@@ -31,6 +37,7 @@ class CSSCounterStyleRule;
 class CSSCounterStyleMap;
 class CSSCounterStyle;
 class CSSMediaRule;
+class CSSParserContext;
 
 enum class CSSStyleOrigin : uint8_t;
 
@@ -38,6 +45,9 @@ using CSSRuleList = std::pmr::vector<RefPtr<CSSRule>>;
 using CSSRuleDataList = std::pmr::vector<CSSRuleData>;
 using CSSPageRuleDataList = std::pmr::vector<CSSPageRuleData>;
 
+inline size_t hashRuleDataKey(const HeapString& name) { return std::hash<std::string_view>()(name); }
+inline size_t hashRuleDataKey(const GlobalString& name) { return std::hash<const void*>()(name.data()); }
+
 template<typename T>
 class CSSRuleDataMap {
 public:
@@ -47,25 +57,65 @@ public:
     const CSSRuleDataList* get(const T& name) const;
 
 private:
-    std::pmr::map<T, CSSRuleDataList> m_table;
+    using Entry = std::pair<T, CSSRuleDataList>;
+    static bool isEmptyKey(const T& name) { return std::string_view(name).empty(); }
+    size_t lookup(const T& name) const;
+    void rehash(size_t capacity);
+
+    std::pmr::vector<Entry> m_table;
+    size_t m_size{0};
 };
 
 template<typename T>
 bool CSSRuleDataMap<T>::add(const T& name, CSSRuleData&& rule)
 {
-    auto resource = m_table.get_allocator().resource();
-    auto [it, inserted] = m_table.try_emplace(name, CSSRuleDataList(resource));
-    it->second.push_back(std::move(rule));
+    assert(!isEmptyKey(name));
+    if(2 * (m_size + 1) > m_table.size())
+        rehash(std::max<size_t>(16, 2 * m_table.size()));
+    auto& entry = m_table[lookup(name)];
+    auto inserted = isEmptyKey(entry.first);
+    if(inserted) {
+        entry.first = name;
+        ++m_size;
+    }
+
+    entry.second.push_back(std::move(rule));
     return inserted;
 }
 
 template<typename T>
 const CSSRuleDataList* CSSRuleDataMap<T>::get(const T& name) const
 {
-    auto it = m_table.find(name);
-    if(it == m_table.end())
+    if(m_size == 0 || isEmptyKey(name))
         return nullptr;
-    return &it->second;
+    const auto& entry = m_table[lookup(name)];
+    if(isEmptyKey(entry.first))
+        return nullptr;
+    return &entry.second;
+}
+
+template<typename T>
+size_t CSSRuleDataMap<T>::lookup(const T& name) const
+{
+    const auto mask = m_table.size() - 1;
+    auto index = static_cast<size_t>((uint64_t(hashRuleDataKey(name)) * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while(!isEmptyKey(m_table[index].first) && !(m_table[index].first == name))
+        index = (index + 1) & mask;
+    return index;
+}
+
+template<typename T>
+void CSSRuleDataMap<T>::rehash(size_t capacity)
+{
+    std::pmr::vector<Entry> table(capacity, m_table.get_allocator());
+    table.swap(m_table);
+    for(auto& entry : table) {
+        if(!isEmptyKey(entry.first)) {
+            auto& newEntry = m_table[lookup(entry.first)];
+            newEntry.first = entry.first;
+            newEntry.second.swap(entry.second);
+        }
+    }
 }
 
 class FontData;
@@ -83,13 +133,154 @@ enum class PageMarginType : uint8_t;
 
 using CSSFontFaceMap = std::pmr::map<GlobalString, std::map<FontSelectionDescription, RefPtr<SegmentedFontFace>>>;
 
+using CSSRuleDataRefList = std::vector<const CSSRuleData*>;
+
+class CSSPseudoRuleMatches {
+public:
+    CSSPseudoRuleMatches() = default;
+
+    bool empty() const { return m_pseudoTypes == 0; }
+    bool contains(PseudoType pseudoType) const { return m_pseudoTypes & (1 << index(pseudoType)); }
+    const CSSRuleDataRefList& get(PseudoType pseudoType) const { return m_rules[index(pseudoType)]; }
+    void add(const CSSRuleData* rule, PseudoType pseudoType);
+
+private:
+    static size_t index(PseudoType pseudoType) { return static_cast<size_t>(pseudoType) - 1; }
+    static const unsigned maxPseudoTypeCount = 5;
+    uint32_t m_pseudoTypes{0};
+    std::array<CSSRuleDataRefList, maxPseudoTypeCount> m_rules;
+};
+
+struct CSSElementRuleMatches {
+    CSSRuleDataRefList rules;
+    CSSPseudoRuleMatches pseudoRules;
+    bool canShareStyle = true;
+};
+
+class CSSStyleSharingCache {
+public:
+    CSSStyleSharingCache() = default;
+
+    RefPtr<BoxStyle> find(const Element* element, const BoxStyle* parentStyle);
+    void add(const Element* element, RefPtr<BoxStyle> style);
+
+    uint32_t hitCount() const { return m_hitCount; }
+    uint32_t missCount() const { return m_missCount; }
+
+private:
+    static bool canShareStyle(const Element* a, const Element* b);
+    static const unsigned maxEntryCount = 16;
+    struct Entry {
+        const Element* element = nullptr;
+        RefPtr<BoxStyle> style;
+    };
+
+    std::array<Entry, maxEntryCount> m_entries;
+    unsigned m_nextEntry{0};
+    uint32_t m_hitCount{0};
+    uint32_t m_missCount{0};
+};
+
+class CSSRuleDataSet {
+public:
+    explicit CSSRuleDataSet(Heap* heap);
+
+    void addStyleRule(CSSStyleRule& rule, uint32_t position);
+
+    const CSSRuleDataList* idRules(const HeapString& name) const { return m_idRules.get(name); }
+    const CSSRuleDataList* classRules(const HeapString& name) const { return m_classRules.get(name); }
+    const CSSRuleDataList* tagRules(const GlobalString& name) const { return m_tagRules.get(name); }
+    const CSSRuleDataList* attributeRules(const GlobalString& name) const { return m_attributeRules.get(name); }
+    const CSSRuleDataList* pseudoIdRules(const HeapString& name) const { return m_pseudoIdRules.get(name); }
+    const CSSRuleDataList* pseudoClassRules(const HeapString& name) const { return m_pseudoClassRules.get(name); }
+    const CSSRuleDataList* pseudoTagRules(const GlobalString& name) const { return m_pseudoTagRules.get(name); }
+    const CSSRuleDataList* pseudoAttributeRules(const GlobalString& name) const { return m_pseudoAttributeRules.get(name); }
+    const CSSRuleDataList* universalRules() const { return &m_universalRules; }
+    const CSSRuleDataList* universalPseudoRules() const { return &m_universalPseudoRules; }
+
+private:
+    CSSRuleDataMap<HeapString> m_idRules;
+    CSSRuleDataMap<HeapString> m_classRules;
+    CSSRuleDataMap<GlobalString> m_tagRules;
+    CSSRuleDataMap<GlobalString> m_attributeRules;
+    CSSRuleDataMap<HeapString> m_pseudoIdRules;
+    CSSRuleDataMap<HeapString> m_pseudoClassRules;
+    CSSRuleDataMap<GlobalString> m_pseudoTagRules;
+    CSSRuleDataMap<GlobalString> m_pseudoAttributeRules;
+
+    CSSRuleDataList m_universalRules;
+    CSSRuleDataList m_universalPseudoRules;
+};
+
+class CSSCachedStyleSheet {
+public:
+    CSSCachedStyleSheet(std::string_view content, const CSSParserContext& context);
+
+    const HeapString& content() const { return m_content; }
+    const CSSRuleList& rules() const { return m_rules; }
+
+    CSSStyleOrigin origin() const { return m_origin; }
+    bool inHTMLDocument() const { return m_inHTMLDocument; }
+
+private:
+    Heap m_heap;
+    HeapString m_content;
+    CSSRuleList m_rules;
+    CSSStyleOrigin m_origin;
+    bool m_inHTMLDocument;
+};
+
+class CSSStyleSheetCache {
+public:
+    std::shared_ptr<const CSSCachedStyleSheet> parseSheet(std::string_view content, const CSSParserContext& context);
+
+    void evict(std::string_view url);
+    void clear();
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+
+private:
+    CSSStyleSheetCache() = default;
+    void trim(size_t capacity);
+
+    struct Key {
+        std::string url;
+        size_t contentHash;
+        CSSStyleOrigin origin;
+        bool inHTMLDocument;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Node {
+        std::shared_ptr<const CSSCachedStyleSheet> styleSheet;
+        std::list<const Key*>::iterator position;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<Key, Node, KeyHash> m_table;
+    std::list<const Key*> m_order;
+    std::atomic_bool m_enabled{false};
+    friend CSSStyleSheetCache* styleSheetCache();
+};
+
+CSSStyleSheetCache* styleSheetCache();
+
 class CSSStyleSheet {
 public:
     explicit CSSStyleSheet(Document* document);
     ~CSSStyleSheet();
 
     RefPtr<BoxStyle> styleForElement(Element* element, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle) const;
-    RefPtr<BoxStyle> pseudoStyleForElement(Element* element, PseudoType pseudoType, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle) const;
+    RefPtr<BoxStyle> styleForElement(Element* element, const CSSElementRuleMatches& matches, const BoxStyle* parentStyle) const;
+    RefPtr<BoxStyle> pseudoStyleForElement(Element* element, PseudoType pseudoType, const CSSPseudoRuleMatches& matches, const BoxStyle* parentStyle) const;
+    CSSPseudoRuleMatches pseudoRulesForElement(Element* element, const SelectorFilter& selectorFilter) const;
+    CSSElementRuleMatches rulesForElement(Element* element, const SelectorFilter& selectorFilter) const;
 
     RefPtr<BoxStyle> styleForPage(const GlobalString& pageName, uint32_t pageIndex, PseudoType pseudoType) const;
     RefPtr<BoxStyle> styleForPageMargin(const GlobalString& pageName, uint32_t pageIndex, PageMarginType marginType, const BoxStyle* pageStyle) const;
@@ -101,8 +292,18 @@ public:
     std::string getMarkerText(int value, const GlobalString& listType);
 
     void parseStyle(std::string_view content, CSSStyleOrigin origin, Url baseUrl);
+    void parseExternalStyle(std::string_view content, CSSStyleOrigin origin, Url url);
+
+    uint32_t styleSharingHitCount() const { return m_styleSharingCache.hitCount(); }
+    uint32_t styleSharingMissCount() const { return m_styleSharingCache.missCount(); }
+
+    uint32_t selectorFilterRejectCount() const { return m_selectorFilterRejectCount; }
+    uint32_t selectorFilterMatchCount() const { return m_selectorFilterMatchCount; }
+    void addSelectorFilterCounts(const SelectorFilter& selectorFilter) const;
 
 private:
+    RefPtr<BoxStyle> buildElementStyle(Element* element, const CSSElementRuleMatches& matches, const BoxStyle* parentStyle) const;
+
     void addRules(const CSSRuleList& rules);
     void addStyleRule(CSSStyleRule& rule);
     void addImportRule(CSSImportRule& rule);
@@ -117,19 +318,18 @@ private:
     uint32_t m_ruleCount{0};
     uint32_t m_importDepth{0};
 
-    CSSRuleDataMap<HeapString> m_idRules;
-    CSSRuleDataMap<HeapString> m_classRules;
-    CSSRuleDataMap<GlobalString> m_tagRules;
-    CSSRuleDataMap<GlobalString> m_attributeRules;
-    CSSRuleDataMap<PseudoType> m_pseudoRules;
-
-    CSSRuleDataList m_universalRules;
+    const CSSRuleDataSet* m_userAgentRules{nullptr};
+    CSSRuleDataSet m_authorRules;
     CSSPageRuleDataList m_pageRules;
     CSSFontFaceMap m_fontFaces;
 
     std::unique_ptr<CSSRuleList> m_counterStyleRules;
     std::unique_ptr<CSSCounterStyleMap> m_counterStyleMap;
 
+    mutable CSSStyleSharingCache m_styleSharingCache;
+    mutable uint32_t m_selectorFilterRejectCount{0};
+    mutable uint32_t m_selectorFilterMatchCount{0};
+
     friend class Document;
 };
 
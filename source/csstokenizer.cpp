@@ -23,11 +23,11 @@ const CSSToken CSSTokenStream::eofToken(CSSToken::Type::EndOfFile);
 CSSTokenizer::CSSTokenizer(std::string_view input)
     : m_input(input)
 {
-    m_tokenList.reserve(input.length() / 3);
 }
 
 CSSTokenStream CSSTokenizer::tokenize()
 {
+    m_tokenList.reserve(m_input.length() / 3);
     while(true) {
         auto token = nextToken();
         if(token.type() == CSSToken::Type::Comment)
@@ -40,6 +40,59 @@ CSSTokenStream CSSTokenizer::tokenize()
     return CSSTokenStream(m_tokenList.data(), m_tokenList.size());
 }
 
+CSSTokenStream CSSTokenizer::tokenizeRule()
+{
+    m_tokenList.clear();
+    m_stringList.clear();
+    m_blockTypes.clear();
+    auto ruleType = CSSToken::Type::EndOfFile;
+    while(true) {
+        auto token = nextToken();
+        if(token.type() == CSSToken::Type::Comment)
+            continue;
+        if(token.type() == CSSToken::Type::EndOfFile)
+            break;
+        m_tokenList.push_back(token);
+        if(ruleType == CSSToken::Type::EndOfFile) {
+            if(token.type() == CSSToken::Type::Whitespace
+                || token.type() == CSSToken::Type::CDO
+                || token.type() == CSSToken::Type::CDC) {
+                continue;
+            }
+
+            ruleType = token.type();
+        }
+
+        switch(token.type()) {
+        case CSSToken::Type::Function:
+        case CSSToken::Type::LeftParenthesis:
+        case CSSToken::Type::LeftSquareBracket:
+        case CSSToken::Type::LeftCurlyBracket:
+            m_blockTypes.push_back(CSSToken::closeType(token.type()));
+            break;
+        case CSSToken::Type::RightParenthesis:
+        case CSSToken::Type::RightSquareBracket:
+        case CSSToken::Type::RightCurlyBracket:
+            if(!m_blockTypes.empty() && m_blockTypes.back() == token.type()) {
+                m_blockTypes.pop_back();
+                if(m_blockTypes.empty() && token.type() == CSSToken::Type::RightCurlyBracket) {
+                    return CSSTokenStream(m_tokenList.data(), m_tokenList.size());
+                }
+            }
+
+            break;
+        case CSSToken::Type::Semicolon:
+            if(m_blockTypes.empty() && ruleType == CSSToken::Type::AtKeyword)
+                return CSSTokenStream(m_tokenList.data(), m_tokenList.size());
+            break;
+        default:
+            break;
+        }
+    }
+
+    return CSSTokenStream(m_tokenList.data(), m_tokenList.size());
+}
+
 bool CSSTokenizer::isEscapeSequence(char first, char second)
 {
     return first == '\\' && !isNewLine(second);
@@ -617,9 +670,9 @@ CSSToken CSSTokenizer::nextToken()
     case ']':
         return CSSToken(CSSToken::Type::RightSquareBracket);
     case '{':
-        return CSSToken(CSSToken::Type::LeftCurlyBracket);
+        return CSSToken(CSSToken::Type::LeftCurlyBracket, m_input.offset(), m_input.offset());
     case '}':
-        return CSSToken(CSSToken::Type::RightCurlyBracket);
+        return CSSToken(CSSToken::Type::RightCurlyBracket, m_input.offset() - 1, m_input.offset() - 1);
     case ',':
         return CSSToken(CSSToken::Type::Comma);
     case ':':
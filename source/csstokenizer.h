@@ -98,6 +98,7 @@ public:
     int integer() const { return clampTo<int>(m_number); }
     uint32_t from() const { return m_from; }
     uint32_t to() const { return m_to; }
+    uint32_t offset() const { return m_from; }
     std::string_view data() const { return m_data; }
 
     static Type closeType(Type type) {
@@ -306,6 +307,7 @@ public:
     explicit CSSTokenizer(std::string_view input);
 
     CSSTokenStream tokenize();
+    CSSTokenStream tokenizeRule();
 
 private:
     static bool isEscapeSequence(char first, char second);
@@ -346,6 +348,7 @@ private:
     CSSTokenizerInputStream m_input;
     CSSTokenList m_tokenList;
     StringList m_stringList;
+    std::vector<CSSToken::Type> m_blockTypes;
 };
 
 } // namespace plutobook
@@ -25,6 +25,8 @@
 
 #include <cmath>
 #include <iostream>
+#include <functional>
+#include <thread>
 
 namespace plutobook {
 
@@ -433,9 +435,7 @@ CSSPropertyList Element::inlineStyle()
     const auto& value = getAttribute(styleAttr);
     if(value.empty())
         return CSSPropertyList();
-    CSSParserContext context(this, CSSStyleOrigin::Inline, document()->baseUrl());
-    CSSParser parser(context, document()->heap());
-    return parser.parseStyle(value);
+    return document()->parseElementStyle(this, CSSStyleOrigin::Inline, value);
 }
 
 CSSPropertyList Element::presentationAttributeStyle()
@@ -447,9 +447,7 @@ CSSPropertyList Element::presentationAttributeStyle()
 
     if(output.empty())
         return CSSPropertyList();
-    CSSParserContext context(this, CSSStyleOrigin::PresentationAttribute, document()->baseUrl());
-    CSSParser parser(context, document()->heap());
-    return parser.parseStyle(output);
+    return document()->parseElementStyle(this, CSSStyleOrigin::PresentationAttribute, output);
 }
 
 Element* Element::parentElement() const
@@ -501,6 +499,93 @@ Element* Element::nextSiblingElement() const
     return nullptr;
 }
 
+template<typename NextFunc, typename IndexFunc>
+static uint32_t resolveSiblingIndex(const Element* element, NextFunc next, IndexFunc index)
+{
+    uint32_t count = 0;
+    auto sibling = element;
+    while(sibling && index(sibling) == 0) {
+        sibling = next(sibling);
+        ++count;
+    }
+
+    auto value = count + (sibling ? index(sibling) : 0);
+    for(sibling = element; count > 0; --count) {
+        index(sibling) = value--;
+        sibling = next(sibling);
+    }
+
+    return index(element);
+}
+
+static const Element* previousSiblingElementOfType(const Element* element)
+{
+    auto sibling = element->previousSiblingElement();
+    while(sibling && !sibling->isOfType(element->namespaceURI(), element->tagName()))
+        sibling = sibling->previousSiblingElement();
+    return sibling;
+}
+
+static const Element* nextSiblingElementOfType(const Element* element)
+{
+    auto sibling = element->nextSiblingElement();
+    while(sibling && !sibling->isOfType(element->namespaceURI(), element->tagName()))
+        sibling = sibling->nextSiblingElement();
+    return sibling;
+}
+
+uint32_t Element::siblingIndex() const
+{
+    return resolveSiblingIndex(this,
+        [](const Element* element) -> const Element* { return element->previousSiblingElement(); },
+        [](const Element* element) -> uint32_t& { return element->m_siblingIndex; });
+}
+
+uint32_t Element::siblingIndexFromEnd() const
+{
+    return resolveSiblingIndex(this,
+        [](const Element* element) -> const Element* { return element->nextSiblingElement(); },
+        [](const Element* element) -> uint32_t& { return element->m_siblingIndexFromEnd; });
+}
+
+uint32_t Element::siblingIndexOfType() const
+{
+    return resolveSiblingIndex(this, previousSiblingElementOfType,
+        [](const Element* element) -> uint32_t& { return element->m_siblingIndexOfType; });
+}
+
+uint32_t Element::siblingIndexOfTypeFromEnd() const
+{
+    return resolveSiblingIndex(this, nextSiblingElementOfType,
+        [](const Element* element) -> uint32_t& { return element->m_siblingIndexOfTypeFromEnd; });
+}
+
+uint64_t Element::featureBit(std::string_view name)
+{
+    return uint64_t(1) << (std::hash<std::string_view>()(name) % 64);
+}
+
+uint64_t Element::featureMask() const
+{
+    auto mask = featureBit(m_tagName.foldCase());
+    if(hasID())
+        mask |= featureBit(m_id);
+    for(const auto& className : m_classNames)
+        mask |= featureBit(className);
+    return mask;
+}
+
+uint64_t Element::descendantFeatureMask() const
+{
+    if(!m_hasDescendantFeatureMask) {
+        for(auto child = firstChildElement(); child; child = child->nextSiblingElement())
+            m_descendantFeatureMask |= child->featureMask() | child->descendantFeatureMask();
+        m_hasDescendantFeatureMask = true;
+    }
+
+    return m_descendantFeatureMask;
+}
+
 Node* Element::cloneNode(bool deep)
 {
     auto newElement = document()->createElement(m_namespaceURI, m_tagName);
@@ -572,8 +657,15 @@ Document::Document(Book* book, Url baseUrl)
     , m_idCache(book->heap())
     , m_localeCache(book->heap())
     , m_resourceCache(book->heap())
+    , m_imageCache(book->heap())
     , m_fontCache(book->heap())
     , m_runningStyles(book->heap())
+    , m_hasSelectorResults(book->heap())
+    , m_variableCache(book->heap())
+    , m_inlineStyleCache(book->heap())
+    , m_svgInlineStyleCache(book->heap())
+    , m_presentationAttributeStyleCache(book->heap())
+    , m_svgPresentationAttributeStyleCache(book->heap())
     , m_styleSheet(this)
 {
 }
@@ -841,6 +933,25 @@ void Document::addRunningStyle(const GlobalString& name, RefPtr<BoxStyle> style)
     m_runningStyles.emplace(name, std::move(style));
 }
 
+const CSSPropertyList& Document::parseElementStyle(const Element* element, CSSStyleOrigin origin, std::string_view content)
+{
+    assert(origin == CSSStyleOrigin::Inline || origin == CSSStyleOrigin::PresentationAttribute);
+    auto& cache = [&]() -> DocumentStyleCache& {
+        if(origin == CSSStyleOrigin::Inline)
+            return element->isSVGElement() ? m_svgInlineStyleCache : m_inlineStyleCache;
+        return element->isSVGElement() ? m_svgPresentationAttributeStyleCache : m_presentationAttributeStyleCache;
+    }();
+
+    auto it = cache.find(content);
+    if(it == cache.end()) {
+        CSSParserContext context(element, origin, m_baseUrl);
+        CSSParser parser(context, heap());
+        it = cache.emplace(heap()->createString(content), parser.parseStyle(content)).first;
+    }
+
+    return it->second;
+}
+
 RefPtr<BoxStyle> Document::getRunningStyle(const GlobalString& name) const
 {
     auto it = m_runningStyles.find(name);
@@ -876,6 +987,11 @@ void Document::addAuthorStyleSheet(std::string_view content, Url baseUrl)
     m_styleSheet.parseStyle(content, CSSStyleOrigin::Author, std::move(baseUrl));
 }
 
+void Document::addExternalStyleSheet(std::string_view content, Url url)
+{
+    m_styleSheet.parseExternalStyle(content, CSSStyleOrigin::Author, std::move(url));
+}
+
 void Document::addUserStyleSheet(std::string_view content)
 {
     m_styleSheet.parseStyle(content, CSSStyleOrigin::User, m_baseUrl);
@@ -966,12 +1082,23 @@ bool Document::supportsMedia(std::string_view type, std::string_view media) cons
 
 RefPtr<BoxStyle> Document::styleForElement(Element* element, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle) const
 {
+    auto it = m_elementRuleMatches.find(element);
+    if(it != m_elementRuleMatches.end())
+        return m_styleSheet.styleForElement(element, it->second, parentStyle);
     return m_styleSheet.styleForElement(element, selectorFilter, parentStyle);
 }
 
-RefPtr<BoxStyle> Document::pseudoStyleForElement(Element* element, PseudoType pseudoType, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle) const
+RefPtr<BoxStyle> Document::pseudoStyleForElement(Element* element, PseudoType pseudoType, const CSSPseudoRuleMatches& matches, const BoxStyle* parentStyle) const
+{
+    return m_styleSheet.pseudoStyleForElement(element, pseudoType, matches, parentStyle);
+}
+
+CSSPseudoRuleMatches Document::pseudoRulesForElement(Element* element, const SelectorFilter& selectorFilter) const
 {
-    return m_styleSheet.pseudoStyleForElement(element, pseudoType, selectorFilter, parentStyle);
+    auto it = m_elementRuleMatches.find(element);
+    if(it != m_elementRuleMatches.end())
+        return it->second.pseudoRules;
+    return m_styleSheet.pseudoRulesForElement(element, selectorFilter);
 }
 
 RefPtr<BoxStyle> Document::styleForPage(const GlobalString& pageName, uint32_t pageIndex, PseudoType pseudoType) const
@@ -1030,6 +1157,18 @@ RefPtr<FontResource> Document::fetchFontResource(const Url& url)
     return fetchResource<FontResource>(url);
 }
 
+const RefPtr<Image>& Document::fetchImage(const CSSImageValue& value)
+{
+    auto [it, inserted] = m_imageCache.try_emplace(&value);
+    if(inserted) {
+        if(auto resource = fetchImageResource(value.value())) {
+            it->second = resource->image();
+        }
+    }
+
+    return it->second;
+}
+
 Node* Document::cloneNode(bool deep)
 {
     return nullptr;
@@ -1075,9 +1214,111 @@ void Document::buildBox(Counters& counters, SelectorFilter& selectorFilter, Box*
 
 void Document::build()
 {
+    matchElementRules();
     Counters counters(this, 0);
     SelectorFilter selectorFilter;
     buildBox(counters, selectorFilter, nullptr);
+    m_styleSheet.addSelectorFilterCounts(selectorFilter);
+    m_elementRuleMatches.clear();
+}
+
+static void updateSelectorFilter(SelectorFilter& selectorFilter, std::vector<const Element*>& ancestors, const Element* parent)
+{
+    if(!ancestors.empty() && ancestors.back() == parent)
+        return;
+    std::vector<const Element*> chain;
+    for(auto element = parent; element; element = element->parentElement())
+        chain.push_back(element);
+    size_t depth = 0;
+    while(depth < ancestors.size() && depth < chain.size() && ancestors[depth] == chain[chain.size() - depth - 1])
+        ++depth;
+    while(ancestors.size() > depth) {
+        selectorFilter.pop();
+        ancestors.pop_back();
+    }
+
+    for(auto it = chain.rbegin() + depth; it != chain.rend(); ++it) {
+        selectorFilter.push(*it);
+        ancestors.push_back(*it);
+    }
+}
+
+void Document::matchElementRules()
+{
+    uint32_t threadCount = m_book->styleThreadCount();
+    if(threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    if(threadCount == 1 || m_rootElement == nullptr) {
+        return;
+    }
+
+    std::vector<Element*> elements;
+    auto element = m_rootElement;
+    while(element) {
+        elements.push_back(element);
+        if(auto child = element->firstChildElement()) {
+            element = child;
+            continue;
+        }
+
+        while(element && !element->nextSiblingElement())
+            element = element->parentElement();
+        if(element) {
+            element = element->nextSiblingElement();
+        }
+    }
+
+    constexpr size_t kMinElementCount = 1024;
+    if(elements.size() < kMinElementCount)
+        return;
+    m_rootElement->descendantFeatureMask();
+    for(auto element : elements) {
+        element->siblingIndex();
+        element->siblingIndexFromEnd();
+        element->siblingIndexOfType();
+        element->siblingIndexOfTypeFromEnd();
+    }
+
+    constexpr size_t kChunkSize = 64;
+    std::vector<CSSElementRuleMatches> results(elements.size());
+    std::atomic_size_t nextIndex(0);
+    auto worker = [&](SelectorFilter& selectorFilter) {
+        std::vector<const Element*> ancestors;
+        size_t index;
+        while((index = nextIndex.fetch_add(kChunkSize)) < elements.size()) {
+            auto end = std::min(index + kChunkSize, elements.size());
+            for(; index < end; ++index) {
+                auto element = elements[index];
+                updateSelectorFilter(selectorFilter, ancestors, element->parentElement());
+                results[index] = m_styleSheet.rulesForElement(element, selectorFilter);
+                if(element->isHTMLElement()) {
+                    results[index].pseudoRules = m_styleSheet.pseudoRulesForElement(element, selectorFilter);
+                }
+            }
+        }
+    };
+
+    threadCount = std::min<size_t>(threadCount, (elements.size() + kChunkSize - 1) / kChunkSize);
+    std::vector<SelectorFilter> selectorFilters(threadCount);
+    std::vector<std::thread> threads;
+    m_matchingRulesInParallel = true;
+    for(uint32_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker, std::ref(selectorFilters[i]));
+    worker(selectorFilters[0]);
+    for(auto& thread : threads) {
+        thread.join();
+    }
+
+    m_matchingRulesInParallel = false;
+
+    for(const auto& selectorFilter : selectorFilters) {
+        m_styleSheet.addSelectorFilterCounts(selectorFilter);
+    }
+
+    m_elementRuleMatches.reserve(elements.size());
+    for(size_t i = 0; i < elements.size(); ++i) {
+        m_elementRuleMatches.emplace(elements[i], std::move(results[i]));
+    }
 }
 
 void Document::layout(FragmentBuilder* fragmentainer)
@@ -12,6 +12,8 @@
 #include "cssstylesheet.h"
 
 #include <forward_list>
+#include <unordered_map>
+#include <mutex>
 
 namespace plutobook {
 
@@ -224,6 +226,15 @@ public:
     Element* previousSiblingElement() const;
     Element* nextSiblingElement() const;
 
+    uint32_t siblingIndex() const;
+    uint32_t siblingIndexFromEnd() const;
+    uint32_t siblingIndexOfType() const;
+    uint32_t siblingIndexOfTypeFromEnd() const;
+
+    static uint64_t featureBit(std::string_view name);
+    uint64_t featureMask() const;
+    uint64_t descendantFeatureMask() const;
+
     bool hasID() const { return !m_id.empty(); }
     bool hasClass() const { return !m_classNames.empty(); }
 
@@ -252,6 +263,13 @@ private:
     ClassNameList m_classNames;
     AttributeList m_attributes;
 
+    mutable uint32_t m_siblingIndex{0};
+    mutable uint32_t m_siblingIndexFromEnd{0};
+    mutable uint32_t m_siblingIndexOfType{0};
+    mutable uint32_t m_siblingIndexOfTypeFromEnd{0};
+    mutable uint64_t m_descendantFeatureMask{0};
+    mutable bool m_hasDescendantFeatureMask{false};
+
     bool m_isCaseSensitive{false};
     bool m_isLinkDestination{false};
     bool m_isLinkSource{false};
@@ -299,6 +317,8 @@ class Resource;
 class ResourceData;
 class TextResource;
 class ImageResource;
+class Image;
+class CSSImageValue;
 class FontResource;
 class ResourceFetcher;
 class LocaleData;
@@ -312,9 +332,28 @@ using CounterMap = std::map<GlobalString, std::vector<int>>;
 using DocumentElementMap = std::pmr::multimap<HeapString, Element*, std::less<>>;
 using DocumentLocaleMap = std::pmr::map<GlobalString, std::unique_ptr<LocaleData>>;
 using DocumentResourceMap = std::pmr::map<Url, RefPtr<Resource>>;
+using DocumentImageMap = std::pmr::map<const CSSImageValue*, RefPtr<Image>>;
 using DocumentFontMap = std::pmr::map<FontDescription, RefPtr<Font>>;
 using DocumentRunningStyleMap = std::pmr::map<GlobalString, RefPtr<BoxStyle>>;
 
+class CSSSimpleSelector;
+
+using DocumentStyleCache = std::pmr::map<HeapString, CSSPropertyList, std::less<>>;
+using DocumentHasSelectorMap = std::pmr::map<std::pair<const Element*, const CSSSimpleSelector*>, bool>;
+
+class CSSVariableData;
+class CSSVariableReferenceValue;
+
+using CSSVariableDependencyList = std::vector<std::pair<std::string_view, const CSSVariableData*>>;
+
+struct DocumentVariableResolution {
+    CSSVariableDependencyList dependencies;
+    CSSPropertyList properties;
+};
+
+using DocumentVariableCache = std::pmr::multimap<const CSSVariableReferenceValue*, DocumentVariableResolution>;
+using DocumentRuleMatchesMap = std::unordered_map<const Element*, CSSElementRuleMatches>;
+
 class BoxView;
 class GraphicsContext;
 class Size;
@@ -375,9 +414,16 @@ public:
     void addRunningStyle(const GlobalString& name, RefPtr<BoxStyle> style);
     RefPtr<BoxStyle> getRunningStyle(const GlobalString& name) const;
 
+    DocumentHasSelectorMap& hasSelectorResults() { return m_hasSelectorResults; }
+    std::mutex& hasSelectorMutex() { return m_hasSelectorMutex; }
+    bool isMatchingRulesInParallel() const { return m_matchingRulesInParallel; }
+    DocumentVariableCache& variableCache() { return m_variableCache; }
+    const CSSPropertyList& parseElementStyle(const Element* element, CSSStyleOrigin origin, std::string_view content);
+
     HeapString getCountersText(const CounterMap& counters, const GlobalString& name, const GlobalString& listStyle, const HeapString& separator);
 
     void addAuthorStyleSheet(std::string_view content, Url baseUrl);
+    void addExternalStyleSheet(std::string_view content, Url url);
     void addUserStyleSheet(std::string_view content);
 
     void runJavaScript(std::string_view script);
@@ -388,8 +434,11 @@ public:
     bool supportsMediaQueries(const CSSMediaQueryList& queries) const;
     bool supportsMedia(std::string_view type, std::string_view media) const;
 
+    const CSSStyleSheet& styleSheet() const { return m_styleSheet; }
+
     RefPtr<BoxStyle> styleForElement(Element* element, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle) const;
-    RefPtr<BoxStyle> pseudoStyleForElement(Element* element, PseudoType pseudoType, const SelectorFilter& selectorFilter, const BoxStyle* parentStyle) const;
+    RefPtr<BoxStyle> pseudoStyleForElement(Element* element, PseudoType pseudoType, const CSSPseudoRuleMatches& matches, const BoxStyle* parentStyle) const;
+    CSSPseudoRuleMatches pseudoRulesForElement(Element* element, const SelectorFilter& selectorFilter) const;
 
     RefPtr<BoxStyle> styleForPage(const GlobalString& pageName, uint32_t pageIndex, PseudoType pseudoType) const;
     RefPtr<BoxStyle> styleForPageMargin(const GlobalString& pageName, uint32_t pageIndex, PageMarginType marginType, const BoxStyle* pageStyle) const;
@@ -405,6 +454,7 @@ public:
     RefPtr<TextResource> fetchTextResource(const Url& url);
     RefPtr<ImageResource> fetchImageResource(const Url& url);
     RefPtr<FontResource> fetchFontResource(const Url& url);
+    const RefPtr<Image>& fetchImage(const CSSImageValue& value);
 
     virtual bool parse(std::string_view content) = 0;
 
@@ -433,6 +483,7 @@ public:
 private:
     template<typename ResourceType>
     RefPtr<ResourceType> fetchResource(const Url& url);
+    void matchElementRules();
     float m_containerWidth{0};
     float m_containerHeight{0};
     Element* m_rootElement{nullptr};
@@ -442,8 +493,18 @@ private:
     DocumentElementMap m_idCache;
     DocumentLocaleMap m_localeCache;
     DocumentResourceMap m_resourceCache;
+    DocumentImageMap m_imageCache;
     DocumentFontMap m_fontCache;
     DocumentRunningStyleMap m_runningStyles;
+    DocumentHasSelectorMap m_hasSelectorResults;
+    DocumentRuleMatchesMap m_elementRuleMatches;
+    std::mutex m_hasSelectorMutex;
+    bool m_matchingRulesInParallel{false};
+    DocumentVariableCache m_variableCache;
+    DocumentStyleCache m_inlineStyleCache;
+    DocumentStyleCache m_svgInlineStyleCache;
+    DocumentStyleCache m_presentationAttributeStyleCache;
+    DocumentStyleCache m_svgPresentationAttributeStyleCache;
     CSSStyleSheet m_styleSheet;
 };
 
@@ -12,8 +12,12 @@
 #include "graphicscontext.h"
 #include "geometry.h"
 #include "textbreakiterator.h"
+#include "plutobook.hpp"
 
 #include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 #include <unicode/uchar.h>
 #include <unicode/uscript.h>
@@ -154,6 +158,240 @@ constexpr int kMaxCharacters = kMaxGlyphs;
 
 #define HB_TO_FLT(v) (static_cast<float>(v) / (1 << 16))
 
+struct TextShapeGlyph {
+    uint16_t glyphIndex;
+    uint16_t characterIndex;
+    float xOffset;
+    float yOffset;
+    float advance;
+};
+
+using TextShapeGlyphList = std::vector<TextShapeGlyph>;
+
+struct TextShapeCacheKey {
+    std::u16string text;
+    const SimpleFontData* fontData;
+    hb_script_t script;
+    hb_language_t language;
+    Direction direction;
+    float letterSpacing;
+    float wordSpacing;
+    std::vector<std::pair<hb_tag_t, uint32_t>> features;
+
+    bool operator==(const TextShapeCacheKey& other) const = default;
+};
+
+struct TextShapeCacheKeyHash {
+    size_t operator()(const TextShapeCacheKey& key) const {
+        auto hash = std::hash<std::u16string>()(key.text);
+        auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+        combine(std::hash<const void*>()(key.fontData));
+        combine(std::hash<const void*>()(key.language));
+        combine(key.script);
+        combine(static_cast<size_t>(key.direction));
+        combine(std::hash<float>()(key.letterSpacing));
+        combine(std::hash<float>()(key.wordSpacing));
+        for(const auto& feature : key.features) {
+            combine(feature.first);
+            combine(feature.second);
+        }
+
+        return hash;
+    }
+};
+
+struct TextShapeCacheEntry {
+    RefPtr<FontData> fontData;
+    TextShapeGlyphList glyphs;
+    float width;
+};
+
+class TextShapeCache {
+public:
+    std::shared_ptr<const TextShapeCacheEntry> find(const TextShapeCacheKey& key);
+    void add(const TextShapeCacheKey& key, std::shared_ptr<const TextShapeCacheEntry> entry);
+
+    bool isEnabled() const { return m_capacity.load(std::memory_order_relaxed) > 0; }
+    void setCapacity(size_t capacity);
+    ShapeCacheStatistics statistics();
+    void clear();
+
+private:
+    TextShapeCache() = default;
+    void evict(size_t capacity);
+
+    struct Node {
+        std::shared_ptr<const TextShapeCacheEntry> entry;
+        std::list<const TextShapeCacheKey*>::iterator position;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<TextShapeCacheKey, Node, TextShapeCacheKeyHash> m_table;
+    std::list<const TextShapeCacheKey*> m_order;
+    std::atomic_size_t m_capacity{0};
+    uint64_t m_hits{0};
+    uint64_t m_misses{0};
+    friend TextShapeCache* textShapeCache();
+};
+
+TextShapeCache* textShapeCache()
+{
+    static TextShapeCache cache;
+    return &cache;
+}
+
+std::shared_ptr<const TextShapeCacheEntry> TextShapeCache::find(const TextShapeCacheKey& key)
+{
+    std::lock_guard guard(m_mutex);
+    auto it = m_table.find(key);
+    if(it == m_table.end()) {
+        ++m_misses;
+        return nullptr;
+    }
+
+    ++m_hits;
+    m_order.splice(m_order.begin(), m_order, it->second.position);
+    return it->second.entry;
+}
+
+void TextShapeCache::add(const TextShapeCacheKey& key, std::shared_ptr<const TextShapeCacheEntry> entry)
+{
+    std::lock_guard guard(m_mutex);
+    auto capacity = m_capacity.load(std::memory_order_relaxed);
+    if(capacity == 0)
+        return;
+    auto [it, inserted] = m_table.try_emplace(key);
+    if(!inserted)
+        return;
+    m_order.push_front(&it->first);
+    it->second.entry = std::move(entry);
+    it->second.position = m_order.begin();
+    evict(capacity);
+}
+
+void TextShapeCache::setCapacity(size_t capacity)
+{
+    std::lock_guard guard(m_mutex);
+    m_capacity.store(capacity, std::memory_order_relaxed);
+    evict(capacity);
+}
+
+ShapeCacheStatistics TextShapeCache::statistics()
+{
+    std::lock_guard guard(m_mutex);
+    return ShapeCacheStatistics{m_hits, m_misses, m_table.size(), m_capacity.load(std::memory_order_relaxed)};
+}
+
+void TextShapeCache::clear()
+{
+    std::lock_guard guard(m_mutex);
+    m_table.clear();
+    m_order.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void TextShapeCache::evict(size_t capacity)
+{
+    while(m_table.size() > capacity) {
+        m_table.erase(*m_order.back());
+        m_order.pop_back();
+    }
+}
+
+static float shapeGlyphs(hb_buffer_t* hbBuffer, const TextShapeCacheKey& key, const std::vector<hb_feature_t>& hbFeatures,
+    const uint16_t* characters, int length, uint16_t characterOffset, TextShapeGlyphList& glyphs)
+{
+    hb_buffer_reset(hbBuffer);
+    hb_buffer_add_utf16(hbBuffer, characters, length, 0, length);
+    hb_buffer_set_direction(hbBuffer, key.direction == Direction::Ltr ? HB_DIRECTION_LTR : HB_DIRECTION_RTL);
+    hb_buffer_set_language(hbBuffer, key.language);
+    hb_buffer_set_script(hbBuffer, key.script);
+    hb_shape(key.fontData->hbFont(), hbBuffer, hbFeatures.data(), hbFeatures.size());
+
+    auto glyphInfos = hb_buffer_get_glyph_infos(hbBuffer, nullptr);
+    auto glyphPositions = hb_buffer_get_glyph_positions(hbBuffer, nullptr);
+    auto numGlyphs = hb_buffer_get_length(hbBuffer);
+
+    float width = 0.f;
+    for(size_t index = 0; index < numGlyphs; ++index) {
+        const auto& glyphInfo = glyphInfos[index];
+        const auto& glyphPosition = glyphPositions[index];
+
+        TextShapeGlyph glyphData;
+        glyphData.glyphIndex = glyphInfo.codepoint;
+        glyphData.characterIndex = characterOffset + glyphInfo.cluster;
+        glyphData.xOffset = HB_TO_FLT(glyphPosition.x_offset);
+        glyphData.yOffset = -HB_TO_FLT(glyphPosition.y_offset);
+        glyphData.advance = HB_TO_FLT(glyphPosition.x_advance - glyphPosition.y_advance);
+        if(key.letterSpacing || key.wordSpacing) {
+            auto character = characters[glyphInfo.cluster];
+            if(key.letterSpacing && !treatAsZeroWidthSpace(character))
+                glyphData.advance += key.letterSpacing;
+            if(key.wordSpacing && treatAsSpace(character)) {
+                glyphData.advance += key.wordSpacing;
+            }
+        }
+
+        width += glyphData.advance;
+        glyphs.push_back(glyphData);
+    }
+
+    return width;
+}
+
+static bool isWordBoundary(const uint16_t* characters, int length, int index)
+{
+    if(characters[index - 1] != kSpaceCharacter && characters[index] != kSpaceCharacter)
+        return false;
+    UChar32 character;
+    U16_GET(characters, 0, index, length, character);
+    return !(U_GET_GC_MASK(character) & U_GC_M_MASK);
+}
+
+static float shapeWords(hb_buffer_t* hbBuffer, TextShapeCacheKey& key, const std::vector<hb_feature_t>& hbFeatures,
+    const uint16_t* characters, int length, TextShapeGlyphList& glyphs)
+{
+    thread_local std::vector<std::pair<int, int>> words;
+    words.clear();
+
+    int wordStart = 0;
+    for(int index = 1; index < length; ++index) {
+        if(isWordBoundary(characters, length, index)) {
+            words.emplace_back(wordStart, index - wordStart);
+            wordStart = index;
+        }
+    }
+
+    words.emplace_back(wordStart, length - wordStart);
+    if(key.direction == Direction::Rtl)
+        std::reverse(words.begin(), words.end());
+
+    auto cache = textShapeCache();
+
+    float width = 0.f;
+    for(const auto& [offset, count] : words) {
+        key.text.assign(reinterpret_cast<const char16_t*>(characters + offset), count);
+        auto entry = cache->find(key);
+        if(entry == nullptr) {
+            auto newEntry = std::make_shared<TextShapeCacheEntry>();
+            newEntry->fontData = const_cast<SimpleFontData*>(key.fontData);
+            newEntry->width = shapeGlyphs(hbBuffer, key, hbFeatures, characters + offset, count, 0, newEntry->glyphs);
+            cache->add(key, newEntry);
+            entry = std::move(newEntry);
+        }
+
+        for(auto glyphData : entry->glyphs) {
+            glyphData.characterIndex += offset;
+            glyphs.push_back(glyphData);
+        }
+
+        width += entry->width;
+    }
+
+    return width;
+}
+
 RefPtr<TextShape> TextShape::createForText(const UString& text, Direction direction, bool disableSpacing, const BoxStyle* style)
 {
     assert(!text.isEmpty());
@@ -166,7 +404,6 @@ RefPtr<TextShape> TextShape::createForText(const UString& text, Direction direct
     auto heap = style->heap();
 
     thread_local hb::unique_ptr<hb_buffer_t> hbBuffer(hb_buffer_create());
-    auto hbDirection = direction == Direction::Ltr ? HB_DIRECTION_LTR : HB_DIRECTION_RTL;
     auto hbLanguage = locale->language();
 
     float totalWidth = 0.f;
@@ -213,8 +450,6 @@ RefPtr<TextShape> TextShape::createForText(const UString& text, Direction direct
         }
 
         assert(numCharacters > 0);
-        auto scriptName = uscript_getShortName(scriptCode);
-        auto hbScript = hb_script_from_string(scriptName, -1);
 
         std::vector<hb_feature_t> hbFeatures;
         auto addFeatures = [&hbFeatures](const FontFeatureList& features) {
@@ -231,43 +466,45 @@ RefPtr<TextShape> TextShape::createForText(const UString& text, Direction direct
         addFeatures(fontFeatures);
         addFeatures(fontData->features());
 
+        TextShapeCacheKey key;
+        key.fontData = fontData;
+        key.script = hb_script_from_string(uscript_getShortName(scriptCode), -1);
+        key.language = hbLanguage;
+        key.direction = direction;
+        key.letterSpacing = letterSpacing;
+        key.wordSpacing = wordSpacing;
+
+        // Only fonts shared through FontDataCache are stable across documents; keying
+        // on a per-document @font-face font would never hit and would pin its file.
+        const auto useShapeCache = fontData->isShared() && textShapeCache()->isEnabled();
+        if(useShapeCache) {
+            for(const auto& feature : hbFeatures) {
+                key.features.emplace_back(feature.tag, feature.value);
+            }
+        }
+
         while(numCharacters > 0) {
             const auto itemLength = std::min(numCharacters, kMaxCharacters);
 
-            hb_buffer_reset(hbBuffer);
-            hb_buffer_add_utf16(hbBuffer, textBuffer + startIndex, itemLength, 0, itemLength);
-            hb_buffer_set_direction(hbBuffer, hbDirection);
-            hb_buffer_set_language(hbBuffer, hbLanguage);
-            hb_buffer_set_script(hbBuffer, hbScript);
-            hb_shape(fontData->hbFont(), hbBuffer, hbFeatures.data(), hbFeatures.size());
-
-            auto glyphInfos = hb_buffer_get_glyph_infos(hbBuffer, nullptr);
-            auto glyphPositions = hb_buffer_get_glyph_positions(hbBuffer, nullptr);
-            auto numGlyphs = hb_buffer_get_length(hbBuffer);
+            thread_local TextShapeGlyphList glyphBuffer;
+            glyphBuffer.clear();
 
             float width = 0.f;
-            TextShapeRunGlyphDataList glyphs(heap, numGlyphs);
-            for(size_t index = 0; index < numGlyphs; ++index) {
-                const auto& glyphInfo = glyphInfos[index];
-                const auto& glyphPosition = glyphPositions[index];
+            if(useShapeCache) {
+                width = shapeWords(hbBuffer, key, hbFeatures, textBuffer + startIndex, itemLength, glyphBuffer);
+            } else {
+                width = shapeGlyphs(hbBuffer, key, hbFeatures, textBuffer + startIndex, itemLength, 0, glyphBuffer);
+            }
 
+            TextShapeRunGlyphDataList glyphs(heap, glyphBuffer.size());
+            for(size_t index = 0; index < glyphBuffer.size(); ++index) {
+                const auto& glyph = glyphBuffer[index];
                 auto& glyphData = glyphs[index];
-                glyphData.glyphIndex = glyphInfo.codepoint;
-                glyphData.characterIndex = glyphInfo.cluster;
-                glyphData.xOffset = HB_TO_FLT(glyphPosition.x_offset);
-                glyphData.yOffset = -HB_TO_FLT(glyphPosition.y_offset);
-                glyphData.advance = HB_TO_FLT(glyphPosition.x_advance - glyphPosition.y_advance);
-
-                if(letterSpacing || wordSpacing) {
-                    auto character = text.charAt(startIndex + glyphData.characterIndex);
-                    if(letterSpacing && !treatAsZeroWidthSpace(character))
-                        glyphData.advance += letterSpacing;
-                    if(wordSpacing && treatAsSpace(character)) {
-                        glyphData.advance += wordSpacing;
-                    }
-                }
-
-                width += glyphData.advance;
+                glyphData.glyphIndex = glyph.glyphIndex;
+                glyphData.characterIndex = glyph.characterIndex;
+                glyphData.xOffset = glyph.xOffset;
+                glyphData.yOffset = glyph.yOffset;
+                glyphData.advance = glyph.advance;
             }
 
             auto textRun = TextShapeRun::create(heap, fontData, startIndex, itemLength, width, std::move(glyphs));
@@ -546,4 +783,19 @@ void TextShapeView::serialize(std::ostream& o) const
     }
 }
 
+void setShapeCacheCapacity(size_t capacity)
+{
+    textShapeCache()->setCapacity(capacity);
+}
+
+ShapeCacheStatistics shapeCacheStatistics()
+{
+    return textShapeCache()->statistics();
+}
+
+void clearShapeCache()
+{
+    textShapeCache()->clear();
+}
+
 } // namespace plutobook
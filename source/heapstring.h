@@ -11,6 +11,9 @@
 
 #include <string_view>
 #include <memory_resource>
+#include <memory>
+#include <vector>
+#include <mutex>
 #include <ostream>
 #include <cstring>
 
@@ -64,6 +67,16 @@ public:
 
     HeapString createString(std::string_view value);
     HeapString concatenateString(std::string_view a, std::string_view b);
+
+    void retain(std::shared_ptr<const void> object) { m_retainedObjects.push_back(std::move(object)); }
+    void release() { m_retainedObjects.clear(); HeapBase::release(); }
+
+    // Serializes lazy work that allocates from a heap reachable from several threads.
+    std::mutex& mutex() { return m_mutex; }
+
+private:
+    std::vector<std::shared_ptr<const void>> m_retainedObjects;
+    std::mutex m_mutex;
 };
 
 inline HeapString Heap::createString(std::string_view value)
@@ -73,11 +73,11 @@ static size_t firstLetterTextLength(const HeapString& text)
     return textLength;
 }
 
-void HTMLElement::buildFirstLetterPseudoBox(SelectorFilter& selectorFilter, Box* parent)
+void HTMLElement::buildFirstLetterPseudoBox(const CSSPseudoRuleMatches& pseudoRules, Box* parent)
 {
-    if(!parent->isBlockFlowBox())
+    if(!parent->isBlockFlowBox() || !pseudoRules.contains(PseudoType::FirstLetter))
         return;
-    auto style = document()->pseudoStyleForElement(this, PseudoType::FirstLetter, selectorFilter, parent->style());
+    auto style = document()->pseudoStyleForElement(this, PseudoType::FirstLetter, pseudoRules, parent->style());
     if(style == nullptr || style->display() == Display::None)
         return;
     auto child = parent->firstChild();
@@ -123,11 +123,11 @@ void HTMLElement::buildFirstLetterPseudoBox(SelectorFilter& selectorFilter, Box*
     }
 }
 
-void HTMLElement::buildPseudoBox(Counters& counters, SelectorFilter& selectorFilter, Box* parent, PseudoType pseudoType)
+void HTMLElement::buildPseudoBox(Counters& counters, const CSSPseudoRuleMatches& pseudoRules, Box* parent, PseudoType pseudoType)
 {
     if(pseudoType == PseudoType::Marker && !parent->isListItemBox())
         return;
-    auto style = document()->pseudoStyleForElement(this, pseudoType, selectorFilter, parent->style());
+    auto style = document()->pseudoStyleForElement(this, pseudoType, pseudoRules, parent->style());
     if(style == nullptr || style->display() == Display::None) {
         return;
     }
@@ -143,7 +143,7 @@ void HTMLElement::buildPseudoBox(Counters& counters, SelectorFilter& selectorFil
     parent->addChild(box);
     if(pseudoType == PseudoType::Before || pseudoType == PseudoType::After) {
         counters.update(box);
-        buildPseudoBox(counters, selectorFilter, box, PseudoType::Marker);
+        buildPseudoBox(counters, pseudoRules, box, PseudoType::Marker);
     }
 
     ContentBoxBuilder(counters, this, box).build(*content);
@@ -151,13 +151,14 @@ void HTMLElement::buildPseudoBox(Counters& counters, SelectorFilter& selectorFil
 
 void HTMLElement::buildElementBox(Counters& counters, SelectorFilter& selectorFilter, Box* box)
 {
+    auto pseudoRules = document()->pseudoRulesForElement(this, selectorFilter);
     counters.update(box);
     counters.push();
-    buildPseudoBox(counters, selectorFilter, box, PseudoType::Marker);
-    buildPseudoBox(counters, selectorFilter, box, PseudoType::Before);
+    buildPseudoBox(counters, pseudoRules, box, PseudoType::Marker);
+    buildPseudoBox(counters, pseudoRules, box, PseudoType::Before);
     buildElementChildrenBox(counters, selectorFilter, box);
-    buildPseudoBox(counters, selectorFilter, box, PseudoType::After);
-    buildFirstLetterPseudoBox(selectorFilter, box);
+    buildPseudoBox(counters, pseudoRules, box, PseudoType::After);
+    buildFirstLetterPseudoBox(pseudoRules, box);
     counters.pop();
 }
 
@@ -1031,7 +1032,7 @@ void HTMLLinkElement::finishParsingDocument()
     if(equals(rel(), "stylesheet", false) && document()->supportsMedia(type(), media())) {
         auto url = getUrlAttribute(hrefAttr);
         if(auto resource = document()->fetchTextResource(url)) {
-            document()->addAuthorStyleSheet(resource->text(), std::move(url));
+            document()->addExternalStyleSheet(resource->text(), std::move(url));
         }
     }
 
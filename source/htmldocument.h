@@ -23,8 +23,8 @@ public:
 
     bool isHTMLElement() const final { return true; }
 
-    void buildFirstLetterPseudoBox(SelectorFilter& selectorFilter, Box* parent);
-    void buildPseudoBox(Counters& counters, SelectorFilter& selectorFilter, Box* parent, PseudoType pseudoType);
+    void buildFirstLetterPseudoBox(const CSSPseudoRuleMatches& pseudoRules, Box* parent);
+    void buildPseudoBox(Counters& counters, const CSSPseudoRuleMatches& pseudoRules, Box* parent, PseudoType pseudoType);
     void buildElementBox(Counters& counters, SelectorFilter& selectorFilter, Box* box);
     void buildBox(Counters& counters, SelectorFilter& selectorFilter, Box* parent) override;
 
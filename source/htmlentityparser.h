@@ -20,6 +20,7 @@ public:
     {}
 
     size_t offset() const { return m_offset; }
+    bool reachedEnd() const { return m_reachedEnd; }
 
     bool parse();
 
@@ -39,6 +40,7 @@ private:
     std::string& m_output;
     bool m_inAttributeValue;
     size_t m_offset{0};
+    bool m_reachedEnd{false};
 };
 
 inline char HTMLEntityParser::currentInputCharacter() const
@@ -53,6 +55,7 @@ inline char HTMLEntityParser::nextInputCharacter()
     m_offset += 1;
     if(m_offset < m_input.length())
         return m_input[m_offset];
+    m_reachedEnd = true;
     return 0;
 }
 
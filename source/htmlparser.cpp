@@ -646,10 +646,38 @@ HTMLParser::HTMLParser(HTMLDocument* document, std::string_view content)
 {
 }
 
+HTMLParser::HTMLParser(HTMLDocument* document)
+    : m_document(document), m_tokenizer(document->heap())
+{
+}
+
 bool HTMLParser::parse()
+{
+    handleTokens();
+    assert(!m_openElements.empty());
+    m_openElements.popAll();
+    m_document->finishParsingDocument();
+    return true;
+}
+
+void HTMLParser::write(std::string_view data)
+{
+    m_tokenizer.appendInput(data);
+    handleTokens();
+}
+
+bool HTMLParser::finish()
+{
+    m_tokenizer.closeInput();
+    return parse();
+}
+
+void HTMLParser::handleTokens()
 {
     while(!m_tokenizer.atEOF()) {
         auto token = m_tokenizer.nextToken();
+        if(m_tokenizer.needsMoreInput())
+            break;
         if(token.type() == HTMLToken::Type::DOCTYPE) {
             handleDoctypeToken(token);
             continue;
@@ -668,11 +696,6 @@ bool HTMLParser::parse()
         m_skipLeadingNewline = false;
         handleToken(token, currentInsertionMode(token));
     }
-
-    assert(!m_openElements.empty());
-    m_openElements.popAll();
-    m_document->finishParsingDocument();
-    return true;
 }
 
 Element* HTMLParser::createHTMLElement(const HTMLTokenView& token) const
@@ -107,10 +107,16 @@ class HTMLDocument;
 class HTMLParser {
 public:
     HTMLParser(HTMLDocument* document, std::string_view content);
+    explicit HTMLParser(HTMLDocument* document);
 
     bool parse();
 
+    void write(std::string_view data);
+    bool finish();
+
 private:
+    void handleTokens();
+
     Element* createHTMLElement(const HTMLTokenView& token) const;
     Element* createElement(const HTMLTokenView& token, const GlobalString& namespaceURI) const;
     Element* cloneElement(const Element* element) const;
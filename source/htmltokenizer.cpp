@@ -10,29 +10,121 @@
 #include "htmlentityparser.h"
 #include "stringutils.h"
 
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PLUTOBOOK_HTMLTOKENIZER_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define PLUTOBOOK_HTMLTOKENIZER_NEON
+#endif
+
 namespace plutobook {
 
+static size_t findCharacterRunEnd(const char* data, size_t length, char a, char b, char c)
+{
+    size_t index = 0;
+#if defined(PLUTOBOOK_HTMLTOKENIZER_SSE2)
+    const auto va = _mm_set1_epi8(a);
+    const auto vb = _mm_set1_epi8(b);
+    const auto vc = _mm_set1_epi8(c);
+    const auto vr = _mm_set1_epi8('\r');
+    const auto vz = _mm_setzero_si128();
+    for(; index + 16 <= length; index += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + index));
+        auto matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, vc), _mm_cmpeq_epi8(chunk, vr)), _mm_cmpeq_epi8(chunk, vz)));
+        if(auto mask = _mm_movemask_epi8(matches)) {
+            return index + std::countr_zero(unsigned(mask));
+        }
+    }
+#elif defined(PLUTOBOOK_HTMLTOKENIZER_NEON)
+    const auto va = vdupq_n_u8(a);
+    const auto vb = vdupq_n_u8(b);
+    const auto vc = vdupq_n_u8(c);
+    const auto vr = vdupq_n_u8('\r');
+    for(; index + 16 <= length; index += 16) {
+        auto chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(data + index));
+        auto matches = vorrq_u8(vorrq_u8(vceqq_u8(chunk, va), vceqq_u8(chunk, vb)),
+            vorrq_u8(vorrq_u8(vceqq_u8(chunk, vc), vceqq_u8(chunk, vr)), vceqzq_u8(chunk)));
+        if(vmaxvq_u8(matches)) {
+            break;
+        }
+    }
+#endif
+    for(; index < length; ++index) {
+        auto cc = data[index];
+        if(cc == a || cc == b || cc == c || cc == '\r' || cc == 0) {
+            break;
+        }
+    }
+
+    return index;
+}
+
+std::string_view HTMLTokenizer::consumeCharacterRun(char a, char b, char c)
+{
+    assert(!m_input.empty() && !m_reconsumeCurrentCharacter);
+    auto length = findCharacterRunEnd(m_input.data() + 1, m_input.size() - 1, a, b, c);
+    auto run = m_input.substr(1, length);
+    m_input.remove_prefix(length);
+    return run;
+}
+
 HTMLTokenView HTMLTokenizer::nextToken()
 {
-    m_currentToken.reset();
+    if(!m_tokenSuspended)
+        m_currentToken.reset();
+    m_tokenSuspended = false;
+    m_needsMoreInput = false;
     if(!m_characterBuffer.empty()) {
         flushCharacterBuffer();
-        assert(m_characterBuffer.empty());
         return m_currentToken;
     }
 
-    if(!m_endTagNameBuffer.empty()) {
+    if(m_hasPendingEndTag) {
         flushEndTagNameBuffer();
-        assert(m_endTagNameBuffer.empty());
+        assert(!m_hasPendingEndTag);
         if(m_state == State::Data) {
             return m_currentToken;
         }
     }
 
-    while(handleState(nextInputCharacter()));
+    while(true) {
+        auto cc = nextInputCharacter();
+        if(m_needsMoreInput)
+            break;
+        const auto input = m_input;
+        const auto state = m_state;
+        if(!handleState(cc))
+            return m_currentToken;
+        if(m_needsMoreInput) {
+            m_input = input;
+            m_state = state;
+            m_reconsumeCurrentCharacter = true;
+            break;
+        }
+    }
+
+    if(!m_characterBuffer.empty()) {
+        m_needsMoreInput = false;
+        flushCharacterBuffer();
+        return m_currentToken;
+    }
+
+    m_tokenSuspended = true;
     return m_currentToken;
 }
 
+void HTMLTokenizer::appendInput(std::string_view data)
+{
+    assert(!m_inputComplete);
+    m_inputBuffer.erase(0, m_inputBuffer.size() - m_input.size());
+    m_inputBuffer.append(data);
+    m_input = m_inputBuffer;
+}
+
 bool HTMLTokenizer::handleState(char cc)
 {
     switch(m_state) {
@@ -195,7 +287,9 @@ bool HTMLTokenizer::handleDataState(char cc)
         return emitEOFToken();
 
     m_characterBuffer += cc;
-    return advanceTo(State::Data);
+    advanceTo(State::Data);
+    m_characterBuffer += consumeCharacterRun('<', '&', '&');
+    return true;
 }
 
 bool HTMLTokenizer::handleCharacterReferenceInDataState(char cc)
@@ -203,7 +297,7 @@ bool HTMLTokenizer::handleCharacterReferenceInDataState(char cc)
     m_entityBuffer.clear();
     if(consumeCharacterReference(m_entityBuffer, false)) {
         m_characterBuffer += m_entityBuffer;
-    } else {
+    } else if(!m_needsMoreInput) {
         m_characterBuffer += '&';
     }
 
@@ -221,7 +315,9 @@ bool HTMLTokenizer::handleRCDATAState(char cc)
         return emitEOFToken();
 
     m_characterBuffer += cc;
-    return advanceTo(State::RCDATA);
+    advanceTo(State::RCDATA);
+    m_characterBuffer += consumeCharacterRun('<', '&', '&');
+    return true;
 }
 
 bool HTMLTokenizer::handleCharacterReferenceInRCDATAState(char cc)
@@ -229,7 +325,7 @@ bool HTMLTokenizer::handleCharacterReferenceInRCDATAState(char cc)
     m_entityBuffer.clear();
     if(consumeCharacterReference(m_entityBuffer, false)) {
         m_characterBuffer += m_entityBuffer;
-    } else {
+    } else if(!m_needsMoreInput) {
         m_characterBuffer += '&';
     }
 
@@ -245,7 +341,9 @@ bool HTMLTokenizer::handleRAWTEXTState(char cc)
         return emitEOFToken();
 
     m_characterBuffer += cc;
-    return advanceTo(State::RAWTEXT);
+    advanceTo(State::RAWTEXT);
+    m_characterBuffer += consumeCharacterRun('<', '<', '<');
+    return true;
 }
 
 bool HTMLTokenizer::handleScriptDataState(char cc)
@@ -257,7 +355,9 @@ bool HTMLTokenizer::handleScriptDataState(char cc)
         return emitEOFToken();
 
     m_characterBuffer += cc;
-    return advanceTo(State::ScriptData);
+    advanceTo(State::ScriptData);
+    m_characterBuffer += consumeCharacterRun('<', '<', '<');
+    return true;
 }
 
 bool HTMLTokenizer::handlePLAINTEXTState(char cc)
@@ -266,7 +366,9 @@ bool HTMLTokenizer::handlePLAINTEXTState(char cc)
         return emitEOFToken();
 
     m_characterBuffer += cc;
-    return advanceTo(State::PLAINTEXT);
+    advanceTo(State::PLAINTEXT);
+    m_characterBuffer += consumeCharacterRun(0, 0, 0);
+    return true;
 }
 
 bool HTMLTokenizer::handleTagOpenState(char cc)
@@ -856,7 +958,9 @@ bool HTMLTokenizer::handleAttributeValueDoubleQuotedState(char cc)
     }
 
     m_currentToken.addToAttributeValue(cc);
-    return advanceTo(State::AttributeValueDoubleQuoted);
+    advanceTo(State::AttributeValueDoubleQuoted);
+    m_currentToken.addToAttributeValue(consumeCharacterRun('"', '&', '&'));
+    return true;
 }
 
 bool HTMLTokenizer::handleAttributeValueSingleQuotedState(char cc)
@@ -875,7 +979,9 @@ bool HTMLTokenizer::handleAttributeValueSingleQuotedState(char cc)
     }
 
     m_currentToken.addToAttributeValue(cc);
-    return advanceTo(State::AttributeValueSingleQuoted);
+    advanceTo(State::AttributeValueSingleQuoted);
+    m_currentToken.addToAttributeValue(consumeCharacterRun('\'', '&', '&'));
+    return true;
 }
 
 bool HTMLTokenizer::handleAttributeValueUnquotedState(char cc)
@@ -909,7 +1015,7 @@ bool HTMLTokenizer::handleCharacterReferenceInAttributeValueState(char cc)
     m_entityBuffer.clear();
     if(consumeCharacterReference(m_entityBuffer, true)) {
         m_currentToken.addToAttributeValue(m_entityBuffer);
-    } else {
+    } else if(!m_needsMoreInput) {
         m_currentToken.addToAttributeValue('&');
     }
 
@@ -980,6 +1086,9 @@ bool HTMLTokenizer::handleMarkupDeclarationOpenState(char cc)
 
     if(consumeString(cdata, true))
         return switchTo(State::CDATASection);
+    if(m_needsMoreInput) {
+        return true;
+    }
 
     m_currentToken.beginComment();
     return switchTo(State::BogusComment);
@@ -1156,6 +1265,9 @@ bool HTMLTokenizer::handleAfterDOCTYPENameState(char cc)
 
     if(consumeString(systemKeyword, false))
         return switchTo(State::AfterDOCTYPESystemKeyword);
+    if(m_needsMoreInput) {
+        return true;
+    }
 
     m_currentToken.setForceQuirks();
     return advanceTo(State::BogusDOCTYPE);
@@ -1515,7 +1627,8 @@ bool HTMLTokenizer::flushCharacterBuffer()
 
 bool HTMLTokenizer::flushEndTagNameBuffer()
 {
-    if(!m_characterBuffer.empty())
+    m_hasPendingEndTag = !m_characterBuffer.empty();
+    if(m_hasPendingEndTag)
         return flushCharacterBuffer();
     m_currentToken.beginEndTag();
     for(auto cc : m_endTagNameBuffer)
@@ -1537,7 +1650,13 @@ bool HTMLTokenizer::flushTemporaryBuffer()
 bool HTMLTokenizer::consumeCharacterReference(std::string& output, bool inAttributeValue)
 {
     HTMLEntityParser entityParser(m_input, output, inAttributeValue);
-    if(!entityParser.parse())
+    auto parsed = entityParser.parse();
+    if(entityParser.reachedEnd() && !m_inputComplete) {
+        m_needsMoreInput = true;
+        return false;
+    }
+
+    if(!parsed)
         return false;
     m_input.remove_prefix(entityParser.offset());
     return true;
@@ -1545,6 +1664,11 @@ bool HTMLTokenizer::consumeCharacterReference(std::string& output, bool inAttrib
 
 bool HTMLTokenizer::consumeString(std::string_view value, bool caseSensitive)
 {
+    if(m_input.size() < value.size() && !m_inputComplete) {
+        m_needsMoreInput = true;
+        return false;
+    }
+
     if(startswith(m_input, value, caseSensitive)) {
         m_input.remove_prefix(value.size());
         return true;
@@ -86,7 +86,7 @@ public:
         m_attributeValue += cc;
     }
 
-    void addToAttributeValue(const std::string& data) {
+    void addToAttributeValue(std::string_view data) {
         assert(m_type == Type::StartTag || m_type == Type::EndTag);
         m_attributeValue += data;
     }
@@ -378,8 +378,16 @@ public:
         : m_input(content), m_currentToken(heap)
     {}
 
+    explicit HTMLTokenizer(Heap* heap)
+        : m_currentToken(heap), m_inputComplete(false)
+    {}
+
     HTMLTokenView nextToken();
 
+    void appendInput(std::string_view data);
+    void closeInput() { m_inputComplete = true; m_needsMoreInput = false; }
+    bool needsMoreInput() const { return m_needsMoreInput; }
+
     State state() const { return m_state; }
     void setState(State state) { m_state = state; }
     bool atEOF() const { return m_currentToken.type() == HTMLToken::Type::EndOfFile; }
@@ -474,10 +482,13 @@ private:
     char nextInputCharacter();
     char handleInputCharacter(char inputCharacter);
 
+    std::string_view consumeCharacterRun(char a, char b, char c);
+
     bool consumeCharacterReference(std::string& output, bool inAttributeValue);
     bool consumeString(std::string_view value, bool caseSensitive);
 
     std::string_view m_input;
+    std::string m_inputBuffer;
     std::string m_entityBuffer;
     std::string m_characterBuffer;
     std::string m_temporaryBuffer;
@@ -487,6 +498,10 @@ private:
     bool m_reconsumeCurrentCharacter{true};
     char m_additionalAllowedCharacter{0};
     HTMLToken m_currentToken;
+    bool m_inputComplete{true};
+    bool m_needsMoreInput{false};
+    bool m_tokenSuspended{false};
+    bool m_hasPendingEndTag{false};
 };
 
 inline bool HTMLTokenizer::advanceTo(State state)
@@ -505,10 +520,12 @@ inline bool HTMLTokenizer::switchTo(State state)
 
 inline char HTMLTokenizer::nextInputCharacter()
 {
-    if(!m_input.empty()) {
-        if(m_reconsumeCurrentCharacter)
-            return handleInputCharacter(m_input.front());
+    if(!m_input.empty() && !m_reconsumeCurrentCharacter)
         m_input.remove_prefix(1);
+    if(!m_inputComplete && (m_input.empty() || (m_input.size() == 1 && m_input.front() == '\r'))) {
+        m_needsMoreInput = true;
+        m_reconsumeCurrentCharacter = true;
+        return 0;
     }
 
     if(!m_input.empty())
@@ -26,6 +26,37 @@ const Length Length::FitContent(Length::Type::FitContent);
 const Length Length::ZeroFixed(Length::Type::Fixed);
 const Length Length::ZeroPercent(Length::Type::Percent);
 
+static_assert(static_cast<unsigned>(CSSPropertyID::ZIndex) < CSSPropertyMap::maxPropertyCount);
+
+CSSPropertyMap::CSSPropertyMap(Heap* heap)
+    : m_entries(heap)
+{
+}
+
+CSSPropertyMap::~CSSPropertyMap() = default;
+
+void CSSPropertyMap::set(CSSPropertyID id, RefPtr<CSSValue> value)
+{
+    auto index = static_cast<unsigned>(id);
+    auto position = m_entries.begin() + rank(index);
+    if(contains(index)) {
+        position->second = std::move(value);
+        return;
+    }
+
+    m_bits[index / wordBits] |= uint64_t(1) << (index % wordBits);
+    m_entries.emplace(position, id, std::move(value));
+}
+
+void CSSPropertyMap::remove(CSSPropertyID id)
+{
+    auto index = static_cast<unsigned>(id);
+    if(!contains(index))
+        return;
+    m_entries.erase(m_entries.begin() + rank(index));
+    m_bits[index / wordBits] &= ~(uint64_t(1) << (index % wordBits));
+}
+
 RefPtr<BoxStyle> BoxStyle::create(Node* node, const BoxStyle* parentStyle, PseudoType pseudoType, Display display)
 {
     return adoptPtr(new (node->heap()) BoxStyle(node, parentStyle, pseudoType, display));
@@ -189,150 +220,6 @@ float BoxStyle::lineHeightValue() const
     return m_lineHeight.value();
 }
 
-Length BoxStyle::left() const
-{
-    auto value = get(CSSPropertyID::Left);
-    if(value == nullptr)
-        return Length::Auto;
-    return convertLengthOrPercentOrAuto(*value);
-}
-
-Length BoxStyle::right() const
-{
-    auto value = get(CSSPropertyID::Right);
-    if(value == nullptr)
-        return Length::Auto;
-    return convertLengthOrPercentOrAuto(*value);
-}
-
-Length BoxStyle::top() const
-{
-    auto value = get(CSSPropertyID::Top);
-    if(value == nullptr)
-        return Length::Auto;
-    return convertLengthOrPercentOrAuto(*value);
-}
-
-Length BoxStyle::bottom() const
-{
-    auto value = get(CSSPropertyID::Bottom);
-    if(value == nullptr)
-        return Length::Auto;
-    return convertLengthOrPercentOrAuto(*value);
-}
-
-Length BoxStyle::width() const
-{
-    auto value = get(CSSPropertyID::Width);
-    if(value == nullptr)
-        return Length::Auto;
-    return convertWidthOrHeightLength(*value);
-}
-
-Length BoxStyle::height() const
-{
-    auto value = get(CSSPropertyID::Height);
-    if(value == nullptr)
-        return Length::Auto;
-    return convertWidthOrHeightLength(*value);
-}
-
-Length BoxStyle::minWidth() const
-{
-    auto value = get(CSSPropertyID::MinWidth);
-    if(value == nullptr)
-        return Length::Auto;
-    return convertWidthOrHeightLength(*value);
-}
-
-Length BoxStyle::minHeight() const
-{
-    auto value = get(CSSPropertyID::MinHeight);
-    if(value == nullptr)
-        return Length::Auto;
-    return convertWidthOrHeightLength(*value);
-}
-
-Length BoxStyle::maxWidth() const
-{
-    auto value = get(CSSPropertyID::MaxWidth);
-    if(value == nullptr)
-        return Length::None;
-    return convertWidthOrHeightLength(*value);
-}
-
-Length BoxStyle::maxHeight() const
-{
-    auto value = get(CSSPropertyID::MaxHeight);
-    if(value == nullptr)
-        return Length::None;
-    return convertWidthOrHeightLength(*value);
-}
-
-Length BoxStyle::marginLeft() const
-{
-    auto value = get(CSSPropertyID::MarginLeft);
-    if(value == nullptr)
-        return Length::ZeroFixed;
-    return convertLengthOrPercentOrAuto(*value);
-}
-
-Length BoxStyle::marginRight() const
-{
-    auto value = get(CSSPropertyID::MarginRight);
-    if(value == nullptr)
-        return Length::ZeroFixed;
-    return convertLengthOrPercentOrAuto(*value);
-}
-
-Length BoxStyle::marginTop() const
-{
-    auto value = get(CSSPropertyID::MarginTop);
-    if(value == nullptr)
-        return Length::ZeroFixed;
-    return convertLengthOrPercentOrAuto(*value);
-}
-
-Length BoxStyle::marginBottom() const
-{
-    auto value = get(CSSPropertyID::MarginBottom);
-    if(value == nullptr)
-        return Length::ZeroFixed;
-    return convertLengthOrPercentOrAuto(*value);
-}
-
-Length BoxStyle::paddingLeft() const
-{
-    auto value = get(CSSPropertyID::PaddingLeft);
-    if(value == nullptr)
-        return Length::ZeroFixed;
-    return convertLengthOrPercent(*value);
-}
-
-Length BoxStyle::paddingRight() const
-{
-    auto value = get(CSSPropertyID::PaddingRight);
-    if(value == nullptr)
-        return Length::ZeroFixed;
-    return convertLengthOrPercent(*value);
-}
-
-Length BoxStyle::paddingTop() const
-{
-    auto value = get(CSSPropertyID::PaddingTop);
-    if(value == nullptr)
-        return Length::ZeroFixed;
-    return convertLengthOrPercent(*value);
-}
-
-Length BoxStyle::paddingBottom() const
-{
-    auto value = get(CSSPropertyID::PaddingBottom);
-    if(value == nullptr)
-        return Length::ZeroFixed;
-    return convertLengthOrPercent(*value);
-}
-
 Color BoxStyle::borderLeftColor() const
 {
     auto value = get(CSSPropertyID::BorderLeftColor);
@@ -486,14 +373,6 @@ RefPtr<Image> BoxStyle::backgroundImage() const
     return convertImageOrNone(*value);
 }
 
-Color BoxStyle::backgroundColor() const
-{
-    auto value = get(CSSPropertyID::BackgroundColor);
-    if(value == nullptr)
-        return Color::Transparent;
-    return convertColor(*value);
-}
-
 BackgroundSize BoxStyle::backgroundSize() const
 {
     auto value = get(CSSPropertyID::BackgroundSize);
@@ -1190,7 +1069,7 @@ void BoxStyle::set(CSSPropertyID id, RefPtr<CSSValue> value)
     }
 
     if(value && apply(id, *value)) {
-        m_properties.insert_or_assign(id, std::move(value));
+        m_properties.set(id, std::move(value));
     }
 }
 
@@ -1227,6 +1106,63 @@ bool BoxStyle::apply(CSSPropertyID id, const CSSValue& value)
     case CSSPropertyID::LineHeight:
         m_lineHeight = convertLineHeight(value);
         break;
+    case CSSPropertyID::Left:
+        m_left = convertLengthOrPercentOrAuto(value);
+        break;
+    case CSSPropertyID::Right:
+        m_right = convertLengthOrPercentOrAuto(value);
+        break;
+    case CSSPropertyID::Top:
+        m_top = convertLengthOrPercentOrAuto(value);
+        break;
+    case CSSPropertyID::Bottom:
+        m_bottom = convertLengthOrPercentOrAuto(value);
+        break;
+    case CSSPropertyID::Width:
+        m_width = convertWidthOrHeightLength(value);
+        break;
+    case CSSPropertyID::Height:
+        m_height = convertWidthOrHeightLength(value);
+        break;
+    case CSSPropertyID::MinWidth:
+        m_minWidth = convertWidthOrHeightLength(value);
+        break;
+    case CSSPropertyID::MinHeight:
+        m_minHeight = convertWidthOrHeightLength(value);
+        break;
+    case CSSPropertyID::MaxWidth:
+        m_maxWidth = convertWidthOrHeightLength(value);
+        break;
+    case CSSPropertyID::MaxHeight:
+        m_maxHeight = convertWidthOrHeightLength(value);
+        break;
+    case CSSPropertyID::MarginLeft:
+        m_marginLeft = convertLengthOrPercentOrAuto(value);
+        break;
+    case CSSPropertyID::MarginRight:
+        m_marginRight = convertLengthOrPercentOrAuto(value);
+        break;
+    case CSSPropertyID::MarginTop:
+        m_marginTop = convertLengthOrPercentOrAuto(value);
+        break;
+    case CSSPropertyID::MarginBottom:
+        m_marginBottom = convertLengthOrPercentOrAuto(value);
+        break;
+    case CSSPropertyID::PaddingLeft:
+        m_paddingLeft = convertLengthOrPercent(value);
+        break;
+    case CSSPropertyID::PaddingRight:
+        m_paddingRight = convertLengthOrPercent(value);
+        break;
+    case CSSPropertyID::PaddingTop:
+        m_paddingTop = convertLengthOrPercent(value);
+        break;
+    case CSSPropertyID::PaddingBottom:
+        m_paddingBottom = convertLengthOrPercent(value);
+        break;
+    case CSSPropertyID::BackgroundColor:
+        m_backgroundColor = convertColor(value);
+        break;
     case CSSPropertyID::BorderLeftStyle:
         m_borderLeftStyle = convertLineStyle(value);
         break;
@@ -1417,6 +1353,63 @@ void BoxStyle::reset(CSSPropertyID id)
     case CSSPropertyID::LineHeight:
         m_lineHeight = Length::Auto;
         break;
+    case CSSPropertyID::Left:
+        m_left = Length::Auto;
+        break;
+    case CSSPropertyID::Right:
+        m_right = Length::Auto;
+        break;
+    case CSSPropertyID::Top:
+        m_top = Length::Auto;
+        break;
+    case CSSPropertyID::Bottom:
+        m_bottom = Length::Auto;
+        break;
+    case CSSPropertyID::Width:
+        m_width = Length::Auto;
+        break;
+    case CSSPropertyID::Height:
+        m_height = Length::Auto;
+        break;
+    case CSSPropertyID::MinWidth:
+        m_minWidth = Length::Auto;
+        break;
+    case CSSPropertyID::MinHeight:
+        m_minHeight = Length::Auto;
+        break;
+    case CSSPropertyID::MaxWidth:
+        m_maxWidth = Length::None;
+        break;
+    case CSSPropertyID::MaxHeight:
+        m_maxHeight = Length::None;
+        break;
+    case CSSPropertyID::MarginLeft:
+        m_marginLeft = Length::ZeroFixed;
+        break;
+    case CSSPropertyID::MarginRight:
+        m_marginRight = Length::ZeroFixed;
+        break;
+    case CSSPropertyID::MarginTop:
+        m_marginTop = Length::ZeroFixed;
+        break;
+    case CSSPropertyID::MarginBottom:
+        m_marginBottom = Length::ZeroFixed;
+        break;
+    case CSSPropertyID::PaddingLeft:
+        m_paddingLeft = Length::ZeroFixed;
+        break;
+    case CSSPropertyID::PaddingRight:
+        m_paddingRight = Length::ZeroFixed;
+        break;
+    case CSSPropertyID::PaddingTop:
+        m_paddingTop = Length::ZeroFixed;
+        break;
+    case CSSPropertyID::PaddingBottom:
+        m_paddingBottom = Length::ZeroFixed;
+        break;
+    case CSSPropertyID::BackgroundColor:
+        m_backgroundColor = Color::Transparent;
+        break;
     case CSSPropertyID::BorderLeftStyle:
         m_borderLeftStyle = LineStyle::None;
         break;
@@ -1571,13 +1564,13 @@ void BoxStyle::reset(CSSPropertyID id)
         break;
     }
 
-    m_properties.erase(id);
+    m_properties.remove(id);
 }
 
 void BoxStyle::inherit(CSSPropertyID id)
 {
     if(auto value = m_parentStyle->get(id))
-        m_properties.insert_or_assign(id, value);
+        m_properties.set(id, value);
     switch(id) {
     case CSSPropertyID::Display:
         m_display = m_originalDisplay = m_parentStyle->display();
@@ -1609,6 +1602,63 @@ void BoxStyle::inherit(CSSPropertyID id)
     case CSSPropertyID::LineHeight:
         m_lineHeight = m_parentStyle->lineHeight();
         break;
+    case CSSPropertyID::Left:
+        m_left = m_parentStyle->left();
+        break;
+    case CSSPropertyID::Right:
+        m_right = m_parentStyle->right();
+        break;
+    case CSSPropertyID::Top:
+        m_top = m_parentStyle->top();
+        break;
+    case CSSPropertyID::Bottom:
+        m_bottom = m_parentStyle->bottom();
+        break;
+    case CSSPropertyID::Width:
+        m_width = m_parentStyle->width();
+        break;
+    case CSSPropertyID::Height:
+        m_height = m_parentStyle->height();
+        break;
+    case CSSPropertyID::MinWidth:
+        m_minWidth = m_parentStyle->minWidth();
+        break;
+    case CSSPropertyID::MinHeight:
+        m_minHeight = m_parentStyle->minHeight();
+        break;
+    case CSSPropertyID::MaxWidth:
+        m_maxWidth = m_parentStyle->maxWidth();
+        break;
+    case CSSPropertyID::MaxHeight:
+        m_maxHeight = m_parentStyle->maxHeight();
+        break;
+    case CSSPropertyID::MarginLeft:
+        m_marginLeft = m_parentStyle->marginLeft();
+        break;
+    case CSSPropertyID::MarginRight:
+        m_marginRight = m_parentStyle->marginRight();
+        break;
+    case CSSPropertyID::MarginTop:
+        m_marginTop = m_parentStyle->marginTop();
+        break;
+    case CSSPropertyID::MarginBottom:
+        m_marginBottom = m_parentStyle->marginBottom();
+        break;
+    case CSSPropertyID::PaddingLeft:
+        m_paddingLeft = m_parentStyle->paddingLeft();
+        break;
+    case CSSPropertyID::PaddingRight:
+        m_paddingRight = m_parentStyle->paddingRight();
+        break;
+    case CSSPropertyID::PaddingTop:
+        m_paddingTop = m_parentStyle->paddingTop();
+        break;
+    case CSSPropertyID::PaddingBottom:
+        m_paddingBottom = m_parentStyle->paddingBottom();
+        break;
+    case CSSPropertyID::BackgroundColor:
+        m_backgroundColor = m_parentStyle->backgroundColor();
+        break;
     case CSSPropertyID::BorderLeftStyle:
         m_borderLeftStyle = m_parentStyle->borderLeftStyle();
         break;
@@ -3385,7 +3435,7 @@ BoxStyle::BoxStyle(Node* node, const BoxStyle* parentStyle, PseudoType pseudoTyp
             case CSSPropertyID::TextIndent:
             case CSSPropertyID::Widows:
             case CSSPropertyID::WordSpacing:
-                m_properties.insert_or_assign(id, value);
+                m_properties.set(id, value);
                 break;
             default:
                 break;
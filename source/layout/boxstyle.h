@@ -17,7 +17,7 @@
 #include <memory>
 #include <optional>
 #include <forward_list>
-#include <unordered_map>
+#include <bit>
 #include <vector>
 #include <map>
 
@@ -648,7 +648,51 @@ using FontFamilyList = std::forward_list<GlobalString>;
 class CSSValue;
 class CSSVariableData;
 
-using CSSPropertyMap = std::pmr::unordered_map<CSSPropertyID, RefPtr<CSSValue>>;
+class CSSPropertyMap {
+public:
+    using Entry = std::pair<CSSPropertyID, RefPtr<CSSValue>>;
+    using EntryList = std::pmr::vector<Entry>;
+
+    explicit CSSPropertyMap(Heap* heap);
+    ~CSSPropertyMap();
+
+    CSSValue* get(CSSPropertyID id) const;
+    void set(CSSPropertyID id, RefPtr<CSSValue> value);
+    void remove(CSSPropertyID id);
+
+    bool empty() const { return m_entries.empty(); }
+    size_t size() const { return m_entries.size(); }
+
+    EntryList::const_iterator begin() const { return m_entries.begin(); }
+    EntryList::const_iterator end() const { return m_entries.end(); }
+
+    static const unsigned maxPropertyCount = 320;
+
+private:
+    static const unsigned wordBits = 64;
+    bool contains(unsigned index) const { return m_bits[index / wordBits] & (uint64_t(1) << (index % wordBits)); }
+    size_t rank(unsigned index) const;
+
+    uint64_t m_bits[maxPropertyCount / wordBits] = {};
+    EntryList m_entries;
+};
+
+inline size_t CSSPropertyMap::rank(unsigned index) const
+{
+    size_t count = 0;
+    for(unsigned word = 0; word < index / wordBits; ++word)
+        count += std::popcount(m_bits[word]);
+    return count + std::popcount(m_bits[index / wordBits] & ((uint64_t(1) << (index % wordBits)) - 1));
+}
+
+inline CSSValue* CSSPropertyMap::get(CSSPropertyID id) const
+{
+    auto index = static_cast<unsigned>(id);
+    if(!contains(index))
+        return nullptr;
+    return m_entries[rank(index)].second.get();
+}
+
 using CSSCustomPropertyMap = std::pmr::map<HeapString, RefPtr<CSSVariableData>, std::less<>>;
 
 enum class PseudoType : uint8_t {
@@ -729,26 +773,26 @@ public:
 
     float lineHeightValue() const;
 
-    Length left() const;
-    Length right() const;
-    Length top() const;
-    Length bottom() const;
-    Length width() const;
-    Length height() const;
-    Length minWidth() const;
-    Length minHeight() const;
-    Length maxWidth() const;
-    Length maxHeight() const;
-
-    Length marginLeft() const;
-    Length marginRight() const;
-    Length marginTop() const;
-    Length marginBottom() const;
-
-    Length paddingLeft() const;
-    Length paddingRight() const;
-    Length paddingTop() const;
-    Length paddingBottom() const;
+    const Length& left() const { return m_left; }
+    const Length& right() const { return m_right; }
+    const Length& top() const { return m_top; }
+    const Length& bottom() const { return m_bottom; }
+    const Length& width() const { return m_width; }
+    const Length& height() const { return m_height; }
+    const Length& minWidth() const { return m_minWidth; }
+    const Length& minHeight() const { return m_minHeight; }
+    const Length& maxWidth() const { return m_maxWidth; }
+    const Length& maxHeight() const { return m_maxHeight; }
+
+    const Length& marginLeft() const { return m_marginLeft; }
+    const Length& marginRight() const { return m_marginRight; }
+    const Length& marginTop() const { return m_marginTop; }
+    const Length& marginBottom() const { return m_marginBottom; }
+
+    const Length& paddingLeft() const { return m_paddingLeft; }
+    const Length& paddingRight() const { return m_paddingRight; }
+    const Length& paddingTop() const { return m_paddingTop; }
+    const Length& paddingBottom() const { return m_paddingBottom; }
 
     LineStyle borderLeftStyle() const { return m_borderLeftStyle; }
     LineStyle borderRightStyle() const { return m_borderRightStyle; }
@@ -778,7 +822,7 @@ public:
     RefPtr<Image> listStyleImage() const;
 
     RefPtr<Image> backgroundImage() const;
-    Color backgroundColor() const;
+    const Color& backgroundColor() const { return m_backgroundColor; }
     BackgroundRepeat backgroundRepeat() const { return m_backgroundRepeat; }
     BackgroundBox backgroundOrigin() const { return m_backgroundOrigin; }
     BackgroundBox backgroundClip() const { return m_backgroundClip; }
@@ -1112,7 +1156,26 @@ private:
     ColumnFill m_columnFill : 1 {ColumnFill::Balance};
 
     Color m_color{Color::Black};
+    Color m_backgroundColor{Color::Transparent};
     Length m_lineHeight{Length::Auto};
+    Length m_left{Length::Auto};
+    Length m_right{Length::Auto};
+    Length m_top{Length::Auto};
+    Length m_bottom{Length::Auto};
+    Length m_width{Length::Auto};
+    Length m_height{Length::Auto};
+    Length m_minWidth{Length::Auto};
+    Length m_minHeight{Length::Auto};
+    Length m_maxWidth{Length::None};
+    Length m_maxHeight{Length::None};
+    Length m_marginLeft{Length::ZeroFixed};
+    Length m_marginRight{Length::ZeroFixed};
+    Length m_marginTop{Length::ZeroFixed};
+    Length m_marginBottom{Length::ZeroFixed};
+    Length m_paddingLeft{Length::ZeroFixed};
+    Length m_paddingRight{Length::ZeroFixed};
+    Length m_paddingTop{Length::ZeroFixed};
+    Length m_paddingBottom{Length::ZeroFixed};
 };
 
 inline bool BoxStyle::isDisplayBlockType(Display display)
@@ -1133,10 +1196,7 @@ inline bool BoxStyle::isDisplayInlineType(Display display)
 
 inline CSSValue* BoxStyle::get(CSSPropertyID id) const
 {
-    auto it = m_properties.find(id);
-    if(it == m_properties.end())
-        return nullptr;
-    return it->second.get();
+    return m_properties.get(id);
 }
 
 } // namespace plutobook
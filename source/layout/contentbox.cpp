@@ -104,6 +104,7 @@ void ContentBoxBuilder::addElement(const CSSValue& value)
 
     SelectorFilter selectorFilter;
     element->buildElementBox(m_counters, selectorFilter, newBox);
+    element->document()->styleSheet().addSelectorFilterCounts(selectorFilter);
     newBox->setIsRunning(true);
     m_lastTextBox = nullptr;
 }
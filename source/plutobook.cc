@@ -669,6 +669,24 @@ bool plutobook_load_xml(plutobook_t* book, const char* data, int length, const c
     return book->loadXml(content, user_style, user_script, base_url);
 }
 
+bool plutobook_load_xml_begin(plutobook_t* book, const char* user_style, const char* user_script, const char* base_url)
+{
+    return book->loadXmlBegin(user_style, user_script, base_url);
+}
+
+bool plutobook_load_xml_write(plutobook_t* book, const char* data, int length)
+{
+    if(length == -1)
+        length = std::strlen(data);
+    std::string_view content(data, length);
+    return book->loadXmlWrite(content);
+}
+
+bool plutobook_load_xml_end(plutobook_t* book)
+{
+    return book->loadXmlEnd();
+}
+
 bool plutobook_load_html(plutobook_t* book, const char* data, int length, const char* user_style, const char* user_script, const char* base_url)
 {
     if(length == -1)
@@ -677,6 +695,24 @@ bool plutobook_load_html(plutobook_t* book, const char* data, int length, const
     return book->loadHtml(content, user_style, user_script, base_url);
 }
 
+bool plutobook_load_html_begin(plutobook_t* book, const char* user_style, const char* user_script, const char* base_url)
+{
+    return book->loadHtmlBegin(user_style, user_script, base_url);
+}
+
+bool plutobook_load_html_write(plutobook_t* book, const char* data, int length)
+{
+    if(length == -1)
+        length = std::strlen(data);
+    std::string_view content(data, length);
+    return book->loadHtmlWrite(content);
+}
+
+bool plutobook_load_html_end(plutobook_t* book)
+{
+    return book->loadHtmlEnd();
+}
+
 void plutobook_render_page(const plutobook_t* book, plutobook_canvas_t* canvas, unsigned int page_index)
 {
     plutobook_render_page_cairo(book, canvas->context, page_index);
@@ -754,6 +790,16 @@ void* plutobook_get_custom_resource_fetcher_closure(const plutobook_t* book)
     return book->custom_resource_fetcher_closure;
 }
 
+void plutobook_set_style_thread_count(plutobook_t* book, unsigned int count)
+{
+    book->setStyleThreadCount(count);
+}
+
+unsigned int plutobook_get_style_thread_count(const plutobook_t* book)
+{
+    return book->styleThreadCount();
+}
+
 struct plutobook_error_info {
     std::unique_ptr<char[]> data;
     size_t size = 0;
@@ -811,9 +857,54 @@ void plutobook_clear_error_message(void)
 
 void plutobook_set_fontconfig_path(const char* path)
 {
-#ifdef _WIN32
-    _putenv_s("FONTCONFIG_PATH", path);
-#else
-    setenv("FONTCONFIG_PATH", path, 1);
-#endif
+    plutobook::setFontconfigPath(path);
+}
+
+void plutobook_set_font_metadata_cache_path(const char* path)
+{
+    plutobook::setFontMetadataCachePath(path);
+}
+
+void plutobook_set_stylesheet_cache_enabled(bool enabled)
+{
+    plutobook::setStyleSheetCacheEnabled(enabled);
+}
+
+bool plutobook_preload_stylesheet(const char* data, int length, const char* url)
+{
+    if(length == -1)
+        length = std::strlen(data);
+    std::string_view content(data, length);
+    return plutobook::preloadStyleSheet(content, url);
+}
+
+void plutobook_evict_stylesheet(const char* url)
+{
+    plutobook::evictStyleSheet(url);
+}
+
+void plutobook_clear_stylesheet_cache(void)
+{
+    plutobook::clearStyleSheetCache();
+}
+
+void plutobook_set_shape_cache_capacity(unsigned int capacity)
+{
+    plutobook::setShapeCacheCapacity(capacity);
+}
+
+plutobook_shape_cache_stats_t plutobook_get_shape_cache_stats(void)
+{
+    auto statistics = plutobook::shapeCacheStatistics();
+    plutobook_shape_cache_stats_t stats;
+    stats.hits = statistics.hits;
+    stats.misses = statistics.misses;
+    stats.entries = statistics.entries;
+    stats.capacity = statistics.capacity;
+    return stats;
+}
+
+void plutobook_clear_shape_cache(void)
+{
+    plutobook::clearShapeCache();
 }
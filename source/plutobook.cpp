@@ -8,7 +8,10 @@
 
 #include "plutobook.hpp"
 #include "htmldocument.h"
+#include "htmlparser.h"
 #include "xmldocument.h"
+#include "xmlparser.h"
+#include "cssproperty.h"
 #include "textresource.h"
 #include "imageresource.h"
 #include "fontresource.h"
@@ -395,7 +398,7 @@ PageSize Book::pageSizeAt(uint32_t pageIndex) const
 bool Book::loadUrl(std::string_view url, std::string_view userStyle, std::string_view userScript)
 {
     auto completeUrl = ResourceLoader::completeUrl(url);
-    auto resource = ResourceLoader::loadUrl(completeUrl, m_customResourceFetcher);
+    auto resource = ResourceLoader::loadDocumentUrl(completeUrl, m_customResourceFetcher);
     if(resource.isNull())
         return false;
     if(loadData(resource.content(), resource.contentLength(), resource.mimeType(), resource.textEncoding(), userStyle, userScript, completeUrl.base())) {
@@ -456,8 +459,88 @@ bool Book::loadHtml(std::string_view content, std::string_view userStyle, std::s
     return loadDocument<HTMLDocument>(content, userStyle, userScript, baseUrl);
 }
 
+bool Book::loadXmlBegin(std::string_view userStyle, std::string_view userScript, std::string_view baseUrl)
+{
+    clearContent();
+    auto document = XMLDocument::create(this, ResourceLoader::completeUrl(baseUrl));
+    m_xmlParser = std::make_unique<XMLParser>(document.get());
+    m_document = std::move(document);
+    m_pendingUserStyle = userStyle;
+    m_pendingUserScript = userScript;
+    return true;
+}
+
+bool Book::loadXmlWrite(std::string_view content)
+{
+    if(m_xmlParser == nullptr)
+        return false;
+    if(!m_xmlParser->write(content)) {
+        clearContent();
+        return false;
+    }
+
+    return true;
+}
+
+bool Book::loadXmlEnd()
+{
+    if(m_xmlParser == nullptr)
+        return false;
+    if(!m_xmlParser->finish()) {
+        clearContent();
+        return false;
+    }
+
+    m_xmlParser.reset();
+    m_document->addUserStyleSheet(m_pendingUserStyle);
+    m_document->runJavaScript(m_pendingUserScript);
+    m_pendingUserStyle.clear();
+    m_pendingUserScript.clear();
+    return true;
+}
+
+bool Book::loadHtmlBegin(std::string_view userStyle, std::string_view userScript, std::string_view baseUrl)
+{
+    clearContent();
+    auto document = HTMLDocument::create(this, ResourceLoader::completeUrl(baseUrl));
+    m_htmlParser = std::make_unique<HTMLParser>(document.get());
+    m_document = std::move(document);
+    m_pendingUserStyle = userStyle;
+    m_pendingUserScript = userScript;
+    return true;
+}
+
+bool Book::loadHtmlWrite(std::string_view content)
+{
+    if(m_htmlParser == nullptr)
+        return false;
+    m_htmlParser->write(content);
+    return true;
+}
+
+bool Book::loadHtmlEnd()
+{
+    if(m_htmlParser == nullptr)
+        return false;
+    if(!m_htmlParser->finish()) {
+        clearContent();
+        return false;
+    }
+
+    m_htmlParser.reset();
+    m_document->addUserStyleSheet(m_pendingUserStyle);
+    m_document->runJavaScript(m_pendingUserScript);
+    m_pendingUserStyle.clear();
+    m_pendingUserScript.clear();
+    return true;
+}
+
 void Book::clearContent()
 {
+    m_htmlParser.reset();
+    m_xmlParser.reset();
+    m_pendingUserStyle.clear();
+    m_pendingUserScript.clear();
     m_document.reset();
     m_heap->release();
     m_needsBuild = true;
@@ -657,6 +740,8 @@ bool Book::loadDocument(std::string_view content, std::string_view userStyle, st
 
 Document* Book::buildIfNeeded() const
 {
+    if(m_htmlParser || m_xmlParser)
+        return nullptr;
     auto document = m_document.get();
     if(document && m_needsBuild) {
         document->build();
@@ -691,4 +776,25 @@ Document* Book::paginateIfNeeded() const
     return document;
 }
 
+void setStyleSheetCacheEnabled(bool enabled)
+{
+    styleSheetCache()->setEnabled(enabled);
+}
+
+bool preloadStyleSheet(std::string_view content, std::string_view url)
+{
+    CSSParserContext context(true, false, CSSStyleOrigin::Author, ResourceLoader::completeUrl(url));
+    return styleSheetCache()->parseSheet(content, context) != nullptr;
+}
+
+void evictStyleSheet(std::string_view url)
+{
+    styleSheetCache()->evict(ResourceLoader::completeUrl(url).value());
+}
+
+void clearStyleSheetCache()
+{
+    styleSheetCache()->clear();
+}
+
 } // namespace plutobook
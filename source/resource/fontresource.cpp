@@ -24,6 +24,12 @@
 
 #include <numbers>
 #include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <bit>
+#include <filesystem>
+#include <random>
+#include <charconv>
 
 namespace plutobook {
 
@@ -669,7 +675,7 @@ static FcPattern* createFontPattern(const FontDataDescription& description)
     return pattern;
 }
 
-static RefPtr<SimpleFontData> createFontData(FcConfig* config, const GlobalString& family, const FontDataDescription& description)
+static FcPattern* matchFamilyPattern(FcConfig* config, const GlobalString& family, const FontDataDescription& description)
 {
     auto pattern = createFontPattern(description);
 
@@ -705,21 +711,12 @@ static RefPtr<SimpleFontData> createFontData(FcConfig* config, const GlobalStrin
 
     FcPatternDestroy(pattern);
     if(matchResult == FcResultMatch)
-        return createFontDataFromPattern(matchPattern, description);
+        return matchPattern;
     FcPatternDestroy(matchPattern);
     return nullptr;
 }
 
-RefPtr<SimpleFontData> FontDataCache::fontDataForFamily(const GlobalString& family, const FontDataDescription& description)
-{
-    std::lock_guard guard(m_mutex);
-    auto& fontData = m_table[family][description];
-    if(fontData == nullptr)
-        fontData = createFontData(m_config, family, description);
-    return fontData;
-}
-
-RefPtr<SimpleFontData> FontDataCache::fontDataForCharacters(const uint16_t* characters, int length, EmojiPolicy emojiPolicy, const FontDataDescription& description)
+static FcPattern* matchCharactersPattern(FcConfig* config, const uint16_t* characters, int length, EmojiPolicy emojiPolicy, const FontDataDescription& description)
 {
     int i = 0;
     uint32_t codepoint;
@@ -740,13 +737,11 @@ RefPtr<SimpleFontData> FontDataCache::fontDataForCharacters(const uint16_t* char
         FcPatternAddBool(pattern, FC_COLOR, FcTrue);
     }
 
-    std::lock_guard guard(m_mutex);
-
-    FcConfigSubstitute(m_config, pattern, FcMatchPattern);
+    FcConfigSubstitute(config, pattern, FcMatchPattern);
     FcDefaultSubstitute(pattern);
 
     FcResult matchResult;
-    auto matchPattern = FcFontMatch(m_config, pattern, &matchResult);
+    auto matchPattern = FcFontMatch(config, pattern, &matchResult);
     if(matchResult == FcResultMatch) {
         matchResult = FcResultNoMatch;
         int matchCharSetIndex = 0;
@@ -764,16 +759,385 @@ RefPtr<SimpleFontData> FontDataCache::fontDataForCharacters(const uint16_t* char
     FcCharSetDestroy(charSet);
     FcPatternDestroy(pattern);
     if(matchResult == FcResultMatch)
-        return createFontDataFromPattern(matchPattern, description);
+        return matchPattern;
     FcPatternDestroy(matchPattern);
     return nullptr;
 }
 
-bool FontDataCache::isFamilyAvailable(const GlobalString& family)
+static size_t hashFontDataDescription(size_t hash, const FontDataDescription& description)
 {
-    std::lock_guard guard(m_mutex);
+    auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+    combine(std::hash<float>()(description.size));
+    combine(std::hash<float>()(description.request.weight));
+    combine(std::hash<float>()(description.request.width));
+    combine(std::hash<float>()(description.request.slope));
+    combine(std::hash<const void*>()(description.lang.data()));
+    return hash;
+}
+
+FontPatternDataKey::FontPatternDataKey(FcPattern* pattern, const FontDataDescription& description)
+    : m_pattern(pattern), m_description(description)
+{
+    FcPatternReference(m_pattern);
+}
+
+FontPatternDataKey::FontPatternDataKey(const FontPatternDataKey& other)
+    : FontPatternDataKey(other.m_pattern, other.m_description)
+{
+}
+
+FontPatternDataKey::~FontPatternDataKey()
+{
+    FcPatternDestroy(m_pattern);
+}
+
+bool FontPatternDataKey::operator==(const FontPatternDataKey& other) const
+{
+    return m_description == other.m_description && FcPatternEqual(m_pattern, other.m_pattern);
+}
+
+size_t FontDataKeyHash::operator()(const FontFamilyDataKey& key) const
+{
+    return hashFontDataDescription(std::hash<const void*>()(key.family.data()), key.description);
+}
+
+size_t FontDataKeyHash::operator()(const FontCharacterDataKey& key) const
+{
+    return hashFontDataDescription(std::hash<uint32_t>()(key.character), key.description);
+}
+
+size_t FontDataKeyHash::operator()(const FontPatternDataKey& key) const
+{
+    return hashFontDataDescription(FcPatternHash(key.pattern()), key.description());
+}
+
+size_t FontDataKeyHash::operator()(const GlobalString& family) const
+{
+    return std::hash<const void*>()(family.data());
+}
+
+static std::string foldFamilyName(std::string_view familyName)
+{
+    std::string foldedName(familyName);
+    for(auto& cc : foldedName)
+        cc = toLower(cc);
+    return foldedName;
+}
+
+constexpr std::string_view kFontMetadataCacheSignature = "plutobook-font-metadata-cache 2";
+constexpr size_t kMaxFontMetadataEntries = 4096;
+
+static std::string fontMetadataEnvironment()
+{
+    std::string environment;
+    for(auto name : { "FONTCONFIG_FILE", "FONTCONFIG_PATH", "FONTCONFIG_SYSROOT", "HOME", "XDG_CONFIG_HOME", "XDG_DATA_HOME" }) {
+        if(auto value = std::getenv(name))
+            environment += value;
+        environment += '\t';
+    }
+
+    return environment;
+}
+
+static long long fontMetadataTimestamp(const std::string& path)
+{
+    std::error_code ec;
+    auto writeTime = std::filesystem::last_write_time(path, ec);
+    if(ec)
+        return -1;
+    return writeTime.time_since_epoch().count();
+}
+
+static std::string fontMetadataStamps(FcConfig* config)
+{
+    std::string stamps;
+    for(auto paths : { FcConfigGetFontDirs(config), FcConfigGetConfigFiles(config) }) {
+        if(paths == nullptr)
+            continue;
+        while(auto path = (const char*)(FcStrListNext(paths))) {
+            stamps += "S\t";
+            stamps += std::to_string(fontMetadataTimestamp(path));
+            stamps += '\t';
+            stamps += path;
+            stamps += '\n';
+        }
+
+        FcStrListDone(paths);
+    }
+
+    return stamps;
+}
+
+static std::string fontMetadataKey(char type, std::string_view name, const FontDataDescription& description)
+{
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%c\t%08x\t%08x\t%08x\t%08x\t", type,
+        std::bit_cast<uint32_t>(description.size),
+        std::bit_cast<uint32_t>(description.request.weight),
+        std::bit_cast<uint32_t>(description.request.width),
+        std::bit_cast<uint32_t>(description.request.slope));
+    std::string key(buffer);
+    key += description.lang.value();
+    key += '\t';
+    key += name;
+    return key;
+}
+
+static std::string fontMetadataKey(const uint16_t* characters, int length, EmojiPolicy emojiPolicy, const FontDataDescription& description)
+{
+    char buffer[8];
+    std::string name(1, '0' + int(emojiPolicy));
+    for(int i = 0; i < length; ++i) {
+        std::snprintf(buffer, sizeof(buffer), ",%04x", characters[i]);
+        name += buffer;
+    }
+
+    return fontMetadataKey('C', name, description);
+}
+
+FontMetadataCache::~FontMetadataCache()
+{
+    clear();
+}
+
+bool FontMetadataCache::load(const std::string& path)
+{
+    m_path = path;
+    clear();
+
+    std::error_code ec;
+    if(!std::filesystem::is_regular_file(path, ec))
+        return false;
+    ByteArray content;
+    if(!loadFile(path, content)) {
+        return false;
+    }
+
+    std::string_view input(content.data(), content.size());
+    auto nextLine = [&input]() {
+        auto end = input.find('\n');
+        if(end == std::string_view::npos)
+            end = input.length();
+        auto line = input.substr(0, end);
+        input.remove_prefix(std::min(end + 1, input.length()));
+        return line;
+    };
+
+    if(nextLine() != kFontMetadataCacheSignature || nextLine() != "E\t" + fontMetadataEnvironment())
+        return false;
+    while(!input.empty()) {
+        auto line = nextLine();
+        if(line.length() < 2 || line[1] != '\t') {
+            clear();
+            return false;
+        }
+
+        auto separator = line.rfind('\t');
+        if(line[0] == 'S') {
+            std::string path(line.substr(separator + 1));
+            if(line.substr(2, separator - 2) != std::to_string(fontMetadataTimestamp(path))) {
+                clear();
+                return false;
+            }
+
+            m_stamps += line;
+            m_stamps += '\n';
+        } else if(line[0] == 'P') {
+            m_patternIndices.emplace(line.substr(2), m_patternNames.size());
+            m_patternNames.emplace_back(line.substr(2));
+        } else if(line[0] == 'K' && separator > 2) {
+            m_entries.emplace(line.substr(2, separator - 2), Entry{std::string(line.substr(separator + 1))});
+        }
+    }
+
+    m_patterns.resize(m_patternNames.size());
+    return true;
+}
+
+void FontMetadataCache::save()
+{
+    if(!m_modified || m_path.empty() || m_stamps.empty())
+        return;
+    std::vector<const std::pair<const std::string, Entry>*> entries;
+    for(auto used : { true, false }) {
+        for(const auto& entry : m_entries) {
+            if(entry.second.used == used && entries.size() < kMaxFontMetadataEntries) {
+                entries.push_back(&entry);
+            }
+        }
+    }
+
+    std::string patterns;
+    std::string keys;
+    std::vector<size_t> patternIndices(m_patternNames.size(), std::string::npos);
+    size_t patternCount = 0;
+    for(auto entry : entries) {
+        std::string value(entry->second.value);
+        size_t index = 0;
+        auto end = value.data() + value.length();
+        auto [ptr, ec] = std::from_chars(value.data(), end, index);
+        if(ec == std::errc() && ptr == end) {
+            if(index >= patternIndices.size())
+                continue;
+            if(patternIndices[index] == std::string::npos) {
+                patternIndices[index] = patternCount++;
+                patterns += "P\t";
+                patterns += m_patternNames[index];
+                patterns += '\n';
+            }
+
+            value = std::to_string(patternIndices[index]);
+        }
+
+        keys += "K\t";
+        keys += entry->first;
+        keys += '\t';
+        keys += value;
+        keys += '\n';
+    }
+
+    std::string content(kFontMetadataCacheSignature);
+    content += "\nE\t";
+    content += fontMetadataEnvironment();
+    content += '\n';
+    content += m_stamps;
+    content += patterns;
+    content += keys;
+
+    auto tempPath = m_path + '.' + std::to_string(std::random_device()()) + ".tmp";
+    if(auto file = openFile(tempPath, FileMode::Write)) {
+        auto written = std::fwrite(content.data(), 1, content.size(), file.get());
+        file.reset();
+        std::error_code ec;
+        if(written == content.size())
+            std::filesystem::rename(tempPath, m_path, ec);
+        if(written != content.size() || ec) {
+            std::filesystem::remove(tempPath, ec);
+        }
+    }
+
+    m_modified = false;
+}
+
+void FontMetadataCache::updateStamps(FcConfig* config)
+{
+    if(m_path.empty())
+        return;
+    auto stamps = fontMetadataStamps(config);
+    if(stamps != m_stamps) {
+        clear();
+        m_stamps = std::move(stamps);
+    }
+}
+
+bool FontMetadataCache::findPattern(const std::string& key, FcPattern*& pattern)
+{
+    auto it = m_entries.find(key);
+    if(it == m_entries.end())
+        return false;
+    const auto& value = it->second.value;
+    if(value == "-") {
+        it->second.used = true;
+        pattern = nullptr;
+        return true;
+    }
+
+    size_t index = 0;
+    auto end = value.data() + value.length();
+    auto [ptr, ec] = std::from_chars(value.data(), end, index);
+    if(ec != std::errc() || ptr != end || index >= m_patterns.size())
+        return false;
+    if(m_patterns[index] == nullptr)
+        m_patterns[index] = FcNameParse((const FcChar8*)(m_patternNames[index].data()));
+    if(m_patterns[index] == nullptr) {
+        return false;
+    }
+
+    it->second.used = true;
+    FcPatternReference(m_patterns[index]);
+    pattern = m_patterns[index];
+    return true;
+}
+
+void FontMetadataCache::insertPattern(const std::string& key, FcPattern* pattern)
+{
+    if(m_path.empty())
+        return;
+    if(pattern == nullptr) {
+        insert(key, "-");
+        return;
+    }
+
+    auto name = FcNameUnparse(pattern);
+    if(name == nullptr)
+        return;
+    std::string patternName((const char*)(name));
+    FcStrFree(name);
+    if(patternName.find('\n') != std::string::npos)
+        return;
+    auto [it, inserted] = m_patternIndices.try_emplace(patternName, m_patternNames.size());
+    if(inserted) {
+        FcPatternReference(pattern);
+        m_patternNames.push_back(std::move(patternName));
+        m_patterns.push_back(pattern);
+    }
+
+    insert(key, std::to_string(it->second));
+}
+
+const std::string* FontMetadataCache::find(const std::string& key)
+{
+    auto it = m_entries.find(key);
+    if(it == m_entries.end())
+        return nullptr;
+    it->second.used = true;
+    return &it->second.value;
+}
+
+void FontMetadataCache::insert(const std::string& key, const std::string& value)
+{
+    if(m_path.empty() || key.find('\n') != std::string::npos || value.find_first_of("\t\n") != std::string::npos)
+        return;
+    m_entries.insert_or_assign(key, Entry{value, true});
+    m_modified = true;
+}
+
+void FontMetadataCache::clear()
+{
+    for(auto pattern : m_patterns) {
+        if(pattern) {
+            FcPatternDestroy(pattern);
+        }
+    }
+
+    m_stamps.clear();
+    m_entries.clear();
+    m_patternNames.clear();
+    m_patterns.clear();
+    m_patternIndices.clear();
+}
+
+FontConfigData::FontConfigData(const std::string& metadataCachePath)
+{
+    if(metadataCachePath.empty() || !metadataCache.load(metadataCachePath)) {
+        loadConfig();
+    }
+}
+
+FontConfigData::~FontConfigData()
+{
+    if(config) {
+        FcConfigDestroy(config);
+    }
+}
+
+FcConfig* FontConfigData::loadConfig()
+{
+    if(config)
+        return config;
+    config = FcInitLoadConfigAndFonts();
     for(auto nameSet : { FcSetSystem, FcSetApplication }) {
-        auto allFonts = FcConfigGetFonts(m_config, nameSet);
+        auto allFonts = FcConfigGetFonts(config, nameSet);
         if(allFonts == nullptr)
             continue;
         for(int fontIndex = 0; fontIndex < allFonts->nfont; ++fontIndex) {
@@ -781,24 +1145,144 @@ bool FontDataCache::isFamilyAvailable(const GlobalString& family)
             int matchFamilyIndex = 0;
             char* matchFamilyName = nullptr;
             while(FcPatternGetString(matchPattern, FC_FAMILY, matchFamilyIndex, (FcChar8**)(&matchFamilyName)) == FcResultMatch) {
-                if(equalsIgnoringCase(family, matchFamilyName))
-                    return true;
+                familyNames.insert(foldFamilyName(matchFamilyName));
                 ++matchFamilyIndex;
             }
         }
     }
 
-    return false;
+    metadataCache.updateStamps(config);
+    return config;
 }
 
-FontDataCache::~FontDataCache()
+template<typename MatchFunc>
+FcPattern* FontConfigData::matchPattern(const std::string& key, MatchFunc match)
+{
+    FcPattern* pattern = nullptr;
+    if(metadataCache.findPattern(key, pattern))
+        return pattern;
+    pattern = match(loadConfig());
+    metadataCache.insertPattern(key, pattern);
+    return pattern;
+}
+
+FontConfigData* FontDataCache::configData()
+{
+    if(auto configData = m_configData.load(std::memory_order_acquire))
+        return configData;
+    std::lock_guard guard(m_mutex);
+    if(auto configData = m_configData.load(std::memory_order_relaxed))
+        return configData;
+    auto configData = new FontConfigData(m_metadataCachePath);
+    m_configData.store(configData, std::memory_order_release);
+    return configData;
+}
+
+void FontDataCache::reloadConfig()
+{
+    std::lock_guard guard(m_mutex);
+    if(auto configData = m_configData.exchange(nullptr, std::memory_order_acq_rel)) {
+        configData->metadataCache.save();
+        m_retiredConfigData.emplace_back(configData);
+    }
+}
+
+void FontDataCache::setMetadataCachePath(const std::string& path)
+{
+    {
+        std::lock_guard guard(m_mutex);
+        if(m_metadataCachePath == path)
+            return;
+        m_metadataCachePath = path;
+    }
+
+    reloadConfig();
+}
+
+RefPtr<SimpleFontData> FontDataCache::fontDataForFamily(const GlobalString& family, const FontDataDescription& description)
+{
+    auto data = configData();
+    FontFamilyDataKey key{family, description};
+    if(auto fontData = data->familyTable.find(key))
+        return *fontData;
+    std::lock_guard guard(m_mutex);
+    if(auto fontData = data->familyTable.find(key))
+        return *fontData;
+    auto pattern = data->matchPattern(fontMetadataKey('F', family.value(), description), [&](FcConfig* config) {
+        return matchFamilyPattern(config, family, description);
+    });
+
+    return data->familyTable.insert(key, fontDataForPattern(data, pattern, description));
+}
+
+RefPtr<SimpleFontData> FontDataCache::fontDataForCharacters(const uint16_t* characters, int length, EmojiPolicy emojiPolicy, const FontDataDescription& description)
 {
-    FcConfigDestroy(m_config);
+    auto data = configData();
+    auto match = [&](FcConfig* config) {
+        return matchCharactersPattern(config, characters, length, emojiPolicy, description);
+    };
+
+    int index = 0;
+    uint32_t codepoint;
+    U16_NEXT(characters, index, length, codepoint);
+    if(index < length) {
+        std::lock_guard guard(m_mutex);
+        auto pattern = data->matchPattern(fontMetadataKey(characters, length, emojiPolicy, description), match);
+        return fontDataForPattern(data, pattern, description);
+    }
+
+    FontCharacterDataKey key{codepoint | (uint32_t(emojiPolicy) << 24), description};
+    if(auto fontData = data->characterTable.find(key))
+        return *fontData;
+    std::lock_guard guard(m_mutex);
+    if(auto fontData = data->characterTable.find(key))
+        return *fontData;
+    auto pattern = data->matchPattern(fontMetadataKey(characters, length, emojiPolicy, description), match);
+    return data->characterTable.insert(key, fontDataForPattern(data, pattern, description));
 }
 
-FontDataCache::FontDataCache()
-    : m_config(FcInitLoadConfigAndFonts())
+RefPtr<SimpleFontData> FontDataCache::fontDataForPattern(FontConfigData* data, FcPattern* pattern, const FontDataDescription& description)
 {
+    if(pattern == nullptr)
+        return nullptr;
+    FontPatternDataKey key(pattern, description);
+    if(auto fontData = data->patternTable.find(key)) {
+        FcPatternDestroy(pattern);
+        return *fontData;
+    }
+
+    auto fontData = createFontDataFromPattern(pattern, description);
+    if(fontData)
+        fontData->m_isShared = true;
+    return data->patternTable.insert(key, std::move(fontData));
+}
+
+bool FontDataCache::isFamilyAvailable(const GlobalString& family)
+{
+    auto data = configData();
+    if(!data->metadataCache.isEnabled())
+        return data->familyNames.contains(foldFamilyName(family.value()));
+    if(auto available = data->availableFamilyTable.find(family))
+        return *available;
+    std::lock_guard guard(m_mutex);
+    if(auto available = data->availableFamilyTable.find(family))
+        return *available;
+    auto familyName = foldFamilyName(family.value());
+    auto key = "A\t" + familyName;
+    if(auto value = data->metadataCache.find(key))
+        return data->availableFamilyTable.insert(family, *value == "+");
+    data->loadConfig();
+    auto available = data->familyNames.contains(familyName);
+    data->metadataCache.insert(key, available ? "+" : "-");
+    return data->availableFamilyTable.insert(family, available);
+}
+
+FontDataCache::~FontDataCache()
+{
+    if(auto configData = m_configData.load(std::memory_order_relaxed)) {
+        configData->metadataCache.save();
+        delete configData;
+    }
 }
 
 FontDataCache* fontDataCache()
@@ -807,6 +1291,21 @@ FontDataCache* fontDataCache()
     return &fontCache;
 }
 
+void setFontconfigPath(const std::string& path)
+{
+#ifdef _WIN32
+    _putenv_s("FONTCONFIG_PATH", path.data());
+#else
+    setenv("FONTCONFIG_PATH", path.data(), 1);
+#endif
+    fontDataCache()->reloadConfig();
+}
+
+void setFontMetadataCachePath(const std::string& path)
+{
+    fontDataCache()->setMetadataCachePath(path);
+}
+
 RefPtr<Font> Font::create(Document* document, const FontDescription& description)
 {
     return adoptPtr(new (document->heap()) Font(document, description));
@@ -826,26 +1325,64 @@ const LocaleData* Font::locale() const
 
 const SimpleFontData* Font::fontDataForCharacters(const uint16_t* characters, int length, EmojiPolicy emojiPolicy) const
 {
-    for(const auto& font : m_fonts) {
-        if(auto fontData = font->fontDataForCharacters(characters, length, emojiPolicy)) {
+    int index = 0;
+    uint32_t codepoint;
+    U16_NEXT(characters, index, length, codepoint);
+    if(index < length) {
+        size_t fontIndex = 0;
+        if(auto fontData = findFontDataForCharacters(characters, length, emojiPolicy, fontIndex))
+            return fontData;
+        if(auto fontData = matchFontDataForCharacters(characters, length, emojiPolicy))
+            return fontData;
+    } else {
+        auto [it, inserted] = m_fallbackCache.try_emplace(codepoint | (uint32_t(emojiPolicy) << 24));
+        auto& entry = it->second;
+        if(entry.fontData)
+            return entry.fontData;
+        if(auto fontData = findFontDataForCharacters(characters, length, emojiPolicy, entry.fontCount)) {
+            entry.fontData = fontData;
+            return fontData;
+        }
+
+        if(inserted) {
+            if(auto fontData = matchFontDataForCharacters(characters, length, emojiPolicy)) {
+                entry.fontData = fontData;
+                return fontData;
+            }
+        }
+    }
+
+    if(emojiPolicy == EmojiPolicy::RequireEmoji)
+        return fontDataForCharacters(characters, length, EmojiPolicy::NoPreference);
+    return m_primaryFont;
+}
+
+const SimpleFontData* Font::findFontDataForCharacters(const uint16_t* characters, int length, EmojiPolicy emojiPolicy, size_t& fontIndex) const
+{
+    for(; fontIndex < m_fonts.size(); ++fontIndex) {
+        if(auto fontData = m_fonts[fontIndex]->fontDataForCharacters(characters, length, emojiPolicy)) {
             return fontData;
         }
     }
 
+    return nullptr;
+}
+
+const SimpleFontData* Font::matchFontDataForCharacters(const uint16_t* characters, int length, EmojiPolicy emojiPolicy) const
+{
     if(auto fontData = fontDataCache()->fontDataForCharacters(characters, length, emojiPolicy, m_description.data)) {
         m_fonts.push_back(fontData);
         return fontData.get();
     }
 
-    if(emojiPolicy == EmojiPolicy::RequireEmoji)
-        return fontDataForCharacters(characters, length, EmojiPolicy::NoPreference);
-    return m_primaryFont;
+    return nullptr;
 }
 
 Font::Font(Document* document, const FontDescription& description)
     : m_document(document)
     , m_description(description)
     , m_fonts(document->heap())
+    , m_fallbackCache(document->heap())
 {
     for(const auto& family : description.families) {
         if(auto font = document->getFontData(family, description.data)) {
@@ -16,13 +16,17 @@
 #include <vector>
 #include <forward_list>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <mutex>
+#include <atomic>
 
 typedef struct hb_font_t hb_font_t;
 typedef struct _cairo_font_face cairo_font_face_t;
 typedef struct _cairo_scaled_font cairo_scaled_font_t;
 typedef struct _FcCharSet FcCharSet;
 typedef struct _FcConfig FcConfig;
+typedef struct _FcPattern FcPattern;
 
 namespace plutobook {
 
@@ -351,6 +355,9 @@ public:
     uint16_t zeroGlyph() const { return m_info.zeroGlyph; }
     uint16_t spaceGlyph() const { return m_info.spaceGlyph; }
 
+    // True when this font is owned by FontDataCache and so outlives any single document.
+    bool isShared() const { return m_isShared; }
+
     ~SimpleFontData() final;
 
 private:
@@ -363,6 +370,8 @@ private:
     FcCharSet* m_charSet;
     FontDataInfo m_info;
     FontFeatureList m_features;
+    bool m_isShared = false;
+    friend class FontDataCache;
 };
 
 class FontDataRange {
@@ -397,20 +406,211 @@ inline RefPtr<SegmentedFontData> SegmentedFontData::create(FontDataRangeList fon
     return adoptPtr(new SegmentedFontData(std::move(fonts)));
 }
 
+// Lookups are lock-free; inserts must be serialized by the caller. Nodes never move,
+// and the bucket arrays a reader may still be walking are kept until destruction.
+template<typename Key, typename Value, typename Hash>
+class FontDataCacheTable {
+public:
+    FontDataCacheTable() : m_buckets(new BucketArray(kInitialBucketCount)) {}
+    ~FontDataCacheTable() { delete m_buckets.load(std::memory_order_relaxed); }
+
+    const Value* find(const Key& key) const;
+    const Value& insert(const Key& key, Value value);
+
+private:
+    FontDataCacheTable(const FontDataCacheTable&) = delete;
+    FontDataCacheTable& operator=(const FontDataCacheTable&) = delete;
+
+    struct Node {
+        Key key;
+        Value value;
+        size_t hash;
+    };
+
+    struct Link {
+        const Node* node;
+        Link* next;
+    };
+
+    struct BucketArray {
+        explicit BucketArray(size_t count) : count(count), buckets(new std::atomic<Link*>[count]()) {}
+        ~BucketArray();
+
+        void add(const Node* node);
+
+        size_t count;
+        std::unique_ptr<std::atomic<Link*>[]> buckets;
+        std::unique_ptr<BucketArray> previous;
+    };
+
+    static constexpr size_t kInitialBucketCount = 64;
+    std::atomic<BucketArray*> m_buckets;
+    std::vector<std::unique_ptr<Node>> m_nodes;
+};
+
+template<typename Key, typename Value, typename Hash>
+FontDataCacheTable<Key, Value, Hash>::BucketArray::~BucketArray()
+{
+    for(size_t index = 0; index < count; ++index) {
+        auto link = buckets[index].load(std::memory_order_relaxed);
+        while(link) {
+            delete std::exchange(link, link->next);
+        }
+    }
+}
+
+template<typename Key, typename Value, typename Hash>
+void FontDataCacheTable<Key, Value, Hash>::BucketArray::add(const Node* node)
+{
+    auto& bucket = buckets[node->hash % count];
+    bucket.store(new Link{node, bucket.load(std::memory_order_relaxed)}, std::memory_order_release);
+}
+
+template<typename Key, typename Value, typename Hash>
+const Value* FontDataCacheTable<Key, Value, Hash>::find(const Key& key) const
+{
+    auto hash = Hash()(key);
+    auto buckets = m_buckets.load(std::memory_order_acquire);
+    auto link = buckets->buckets[hash % buckets->count].load(std::memory_order_acquire);
+    while(link) {
+        auto node = link->node;
+        if(node->hash == hash && node->key == key)
+            return &node->value;
+        link = link->next;
+    }
+
+    return nullptr;
+}
+
+template<typename Key, typename Value, typename Hash>
+const Value& FontDataCacheTable<Key, Value, Hash>::insert(const Key& key, Value value)
+{
+    if(auto existing = find(key))
+        return *existing;
+    auto hash = Hash()(key);
+    const auto& node = m_nodes.emplace_back(new Node{key, std::move(value), hash});
+    auto buckets = m_buckets.load(std::memory_order_relaxed);
+    if(m_nodes.size() <= buckets->count) {
+        buckets->add(node.get());
+        return node->value;
+    }
+
+    auto newBuckets = new BucketArray(buckets->count * 2);
+    for(const auto& entry : m_nodes)
+        newBuckets->add(entry.get());
+    newBuckets->previous.reset(buckets);
+    m_buckets.store(newBuckets, std::memory_order_release);
+    return node->value;
+}
+
+struct FontFamilyDataKey {
+    GlobalString family;
+    FontDataDescription description;
+    bool operator==(const FontFamilyDataKey& other) const = default;
+};
+
+struct FontCharacterDataKey {
+    uint32_t character;
+    FontDataDescription description;
+    bool operator==(const FontCharacterDataKey& other) const = default;
+};
+
+class FontPatternDataKey {
+public:
+    FontPatternDataKey(FcPattern* pattern, const FontDataDescription& description);
+    FontPatternDataKey(const FontPatternDataKey& other);
+    ~FontPatternDataKey();
+
+    FcPattern* pattern() const { return m_pattern; }
+    const FontDataDescription& description() const { return m_description; }
+
+    bool operator==(const FontPatternDataKey& other) const;
+
+private:
+    FontPatternDataKey& operator=(const FontPatternDataKey&) = delete;
+    FcPattern* m_pattern;
+    FontDataDescription m_description;
+};
+
+struct FontDataKeyHash {
+    size_t operator()(const FontFamilyDataKey& key) const;
+    size_t operator()(const FontCharacterDataKey& key) const;
+    size_t operator()(const FontPatternDataKey& key) const;
+    size_t operator()(const GlobalString& family) const;
+};
+
+class FontMetadataCache {
+public:
+    FontMetadataCache() = default;
+    ~FontMetadataCache();
+
+    bool load(const std::string& path);
+    void save();
+    void updateStamps(FcConfig* config);
+
+    bool findPattern(const std::string& key, FcPattern*& pattern);
+    void insertPattern(const std::string& key, FcPattern* pattern);
+
+    const std::string* find(const std::string& key);
+    void insert(const std::string& key, const std::string& value);
+
+    bool isEnabled() const { return !m_path.empty(); }
+
+private:
+    struct Entry {
+        std::string value;
+        bool used = false;
+    };
+
+    void clear();
+
+    std::string m_path;
+    std::string m_stamps;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::unordered_map<std::string, size_t> m_patternIndices;
+    std::vector<std::string> m_patternNames;
+    std::vector<FcPattern*> m_patterns;
+    bool m_modified = false;
+};
+
+struct FontConfigData {
+    explicit FontConfigData(const std::string& metadataCachePath);
+    ~FontConfigData();
+
+    FcConfig* loadConfig();
+
+    template<typename MatchFunc>
+    FcPattern* matchPattern(const std::string& key, MatchFunc match);
+
+    FcConfig* config = nullptr;
+    FontMetadataCache metadataCache;
+    std::unordered_set<std::string> familyNames;
+    FontDataCacheTable<FontFamilyDataKey, RefPtr<SimpleFontData>, FontDataKeyHash> familyTable;
+    FontDataCacheTable<FontCharacterDataKey, RefPtr<SimpleFontData>, FontDataKeyHash> characterTable;
+    FontDataCacheTable<GlobalString, bool, FontDataKeyHash> availableFamilyTable;
+    FontDataCacheTable<FontPatternDataKey, RefPtr<SimpleFontData>, FontDataKeyHash> patternTable;
+};
+
 class FontDataCache {
 public:
     RefPtr<SimpleFontData> fontDataForFamily(const GlobalString& family, const FontDataDescription& description);
     RefPtr<SimpleFontData> fontDataForCharacters(const uint16_t* characters, int length, EmojiPolicy emojiPolicy, const FontDataDescription& description);
 
     bool isFamilyAvailable(const GlobalString& family);
+    void reloadConfig();
+    void setMetadataCachePath(const std::string& path);
 
     ~FontDataCache();
 
 private:
-    FontDataCache();
-    FcConfig* m_config;
+    FontDataCache() = default;
+    FontConfigData* configData();
+    RefPtr<SimpleFontData> fontDataForPattern(FontConfigData* data, FcPattern* pattern, const FontDataDescription& description);
+
     std::mutex m_mutex;
-    std::map<GlobalString, std::map<FontDataDescription, RefPtr<SimpleFontData>>> m_table;
+    std::string m_metadataCachePath;
+    std::atomic<FontConfigData*> m_configData{nullptr};
+    std::vector<std::unique_ptr<FontConfigData>> m_retiredConfigData;
     friend FontDataCache* fontDataCache();
 };
 
@@ -418,6 +618,13 @@ FontDataCache* fontDataCache();
 
 class LocaleData;
 
+struct FontFallbackEntry {
+    const SimpleFontData* fontData{nullptr};
+    size_t fontCount{0};
+};
+
+using FontFallbackCache = std::pmr::unordered_map<uint32_t, FontFallbackEntry>;
+
 class Font : public HeapMember, public RefCounted<Font> {
 public:
     static RefPtr<Font> create(Document* document, const FontDescription& description);
@@ -442,9 +649,13 @@ public:
 
 private:
     Font(Document* document, const FontDescription& description);
+    const SimpleFontData* findFontDataForCharacters(const uint16_t* characters, int length, EmojiPolicy emojiPolicy, size_t& fontIndex) const;
+    const SimpleFontData* matchFontDataForCharacters(const uint16_t* characters, int length, EmojiPolicy emojiPolicy) const;
+
     Document* m_document;
     FontDescription m_description;
     mutable FontDataList m_fonts;
+    mutable FontFallbackCache m_fallbackCache;
     const SimpleFontData* m_primaryFont{nullptr};
     mutable const LocaleData* m_locale{nullptr};
 };
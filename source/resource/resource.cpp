@@ -7,6 +7,7 @@
  */
 
 #include "resource.h"
+#include "textresource.h"
 #include "stringutils.h"
 #include "plutobook.hpp"
 
@@ -20,6 +21,9 @@
 #include <windows.h>
 #else
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 namespace plutobook {
@@ -315,7 +319,7 @@ static bool mimeTypeFromPath(std::string& mimeType, std::string_view path)
 
 constexpr std::string_view kFileUrlPrefix = "file://";
 
-static ResourceData loadLocalFile(std::string_view input)
+static std::string localFilename(std::string_view input)
 {
     assert(startswith(input, kFileUrlPrefix, false));
     input.remove_prefix(kFileUrlPrefix.length());
@@ -327,7 +331,12 @@ static ResourceData loadLocalFile(std::string_view input)
 #ifdef _WIN32
     std::replace(filename.begin(), filename.end(), '/', '\\');
 #endif
+    return filename;
+}
 
+static ResourceData loadLocalFile(std::string_view input)
+{
+    auto filename = localFilename(input);
     auto content = ByteArrayCreate();
     if(!loadFile(filename, *content)) {
         ByteArrayDestroy(content);
@@ -341,6 +350,45 @@ static ResourceData loadLocalFile(std::string_view input)
     return createResourceData(content, mimeType, textEncoding);
 }
 
+#ifndef _WIN32
+
+struct MappedFile {
+    void* data;
+    size_t size;
+};
+
+static void MappedFileDestroy(void* data)
+{
+    auto file = (MappedFile*)(data);
+    munmap(file->data, file->size);
+    delete file;
+}
+
+constexpr size_t kMinMappedFileSize = 1024 * 1024;
+
+static ResourceData mapLocalFile(const std::string& filename, const std::string& mimeType)
+{
+    auto fd = open(filename.data(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1)
+        return ResourceData();
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || size_t(st.st_size) < kMinMappedFileSize || size_t(st.st_size) > MAX_RESOURCE_SIZE) {
+        close(fd);
+        return ResourceData();
+    }
+
+    auto size = size_t(st.st_size);
+    auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+        return ResourceData();
+    madvise(data, size, MADV_SEQUENTIAL);
+    auto file = new MappedFile{data, size};
+    return ResourceData((const char*)(data), size, mimeType, std::string(), MappedFileDestroy, file);
+}
+
+#endif // _WIN32
+
 #ifdef PLUTOBOOK_HAS_CURL
 
 DefaultResourceFetcher::DefaultResourceFetcher()
@@ -478,6 +526,24 @@ ResourceData ResourceLoader::loadUrl(const Url& url, ResourceFetcher* customFetc
     return customFetcher->fetchUrl(url.value());
 }
 
+ResourceData ResourceLoader::loadDocumentUrl(const Url& url, ResourceFetcher* customFetcher)
+{
+#ifndef _WIN32
+    if(customFetcher == nullptr && startswith(url.value(), kFileUrlPrefix, false)) {
+        auto filename = localFilename(url.value());
+        std::string mimeType;
+        if(mimeTypeFromPath(mimeType, filename) && TextResource::isXMLMIMEType(mimeType)) {
+            auto resource = mapLocalFile(filename, mimeType);
+            if(!resource.isNull()) {
+                return resource;
+            }
+        }
+    }
+#endif
+
+    return loadUrl(url, customFetcher);
+}
+
 Url ResourceLoader::completeUrl(std::string_view input)
 {
     Url completeUrl(input);
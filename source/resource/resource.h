@@ -56,6 +56,7 @@ class ResourceFetcher;
 class ResourceLoader {
 public:
     static ResourceData loadUrl(const Url& url, ResourceFetcher* customFetcher = nullptr);
+    static ResourceData loadDocumentUrl(const Url& url, ResourceFetcher* customFetcher);
     static Url completeUrl(std::string_view input);
 };
 
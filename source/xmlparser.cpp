@@ -14,12 +14,6 @@
 
 namespace plutobook {
 
-XMLParser::XMLParser(XMLDocument* document)
-    : m_document(document)
-    , m_currentNode(document)
-{
-}
-
 inline XMLParser* getParser(void* userData)
 {
     return (XMLParser*)(userData);
@@ -42,24 +36,57 @@ static void characterDataCallback(void* userData, const XML_Char* data, int leng
 
 constexpr XML_Char kXmlNamespaceSep = '|';
 
+XMLParser::XMLParser(XMLDocument* document)
+    : m_document(document)
+    , m_currentNode(document)
+    , m_parser(XML_ParserCreateNS(NULL, kXmlNamespaceSep))
+{
+    XML_SetUserData(m_parser, this);
+    XML_SetElementHandler(m_parser, startElementCallback, endElementCallback);
+    XML_SetCharacterDataHandler(m_parser, characterDataCallback);
+}
+
+XMLParser::~XMLParser()
+{
+    XML_ParserFree(m_parser);
+}
+
 bool XMLParser::parse(std::string_view content)
 {
-    auto parser = XML_ParserCreateNS(NULL, kXmlNamespaceSep);
-    XML_SetUserData(parser, this);
-    XML_SetElementHandler(parser, startElementCallback, endElementCallback);
-    XML_SetCharacterDataHandler(parser, characterDataCallback);
-    auto status = XML_Parse(parser, content.data(), content.length(), XML_TRUE);
+    return parseChunk(content.data(), content.length(), true);
+}
+
+bool XMLParser::write(std::string_view data)
+{
+    return parseChunk(data.data(), data.length(), false);
+}
+
+bool XMLParser::finish()
+{
+    return parseChunk(nullptr, 0, true);
+}
+
+bool XMLParser::parseChunk(const char* data, size_t length, bool isFinal)
+{
+    constexpr size_t kMaxChunkLength = 1 << 30;
+    while(length > kMaxChunkLength) {
+        if(!parseChunk(data, kMaxChunkLength, false))
+            return false;
+        data += kMaxChunkLength;
+        length -= kMaxChunkLength;
+    }
+
+    auto status = XML_Parse(m_parser, data, (int)(length), isFinal ? XML_TRUE : XML_FALSE);
     if(status == XML_STATUS_OK) {
-        m_document->finishParsingDocument();
-        XML_ParserFree(parser);
+        if(isFinal)
+            m_document->finishParsingDocument();
         return true;
     }
 
-    auto errorString = (const char*)(XML_ErrorString(XML_GetErrorCode(parser)));
-    auto lineNumber = (int)(XML_GetCurrentLineNumber(parser));
-    auto columnNumber = (int)(XML_GetCurrentColumnNumber(parser));
+    auto errorString = (const char*)(XML_ErrorString(XML_GetErrorCode(m_parser)));
+    auto lineNumber = (int)(XML_GetCurrentLineNumber(m_parser));
+    auto columnNumber = (int)(XML_GetCurrentColumnNumber(m_parser));
     plutobook_set_error_message("xml parse error: %s on line %d column %d", errorString, lineNumber, columnNumber);
-    XML_ParserFree(parser);
     return false;
 }
 
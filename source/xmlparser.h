@@ -11,6 +11,8 @@
 
 #include <string_view>
 
+struct XML_ParserStruct;
+
 namespace plutobook {
 
 class XMLDocument;
@@ -19,9 +21,13 @@ class ContainerNode;
 class XMLParser {
 public:
     explicit XMLParser(XMLDocument* document);
+    ~XMLParser();
 
     bool parse(std::string_view content);
 
+    bool write(std::string_view data);
+    bool finish();
+
     void handleStartNamespace(const char* prefix, const char* uri);
     void handleEndNamespace(const char* prefix);
 
@@ -30,8 +36,13 @@ public:
     void handleCharacterData(const char* data, size_t length);
 
 private:
+    XMLParser(const XMLParser&) = delete;
+    XMLParser& operator=(const XMLParser&) = delete;
+    bool parseChunk(const char* data, size_t length, bool isFinal);
+
     XMLDocument* m_document;
     ContainerNode* m_currentNode;
+    XML_ParserStruct* m_parser;
 };
 
 } // namespace plutobook